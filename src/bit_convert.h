@@ -0,0 +1,338 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define BIT_CONVERT_X86 1
+#endif
+
+// Conversion of byte-per-bit values (as returned by `ffrGetVC()` with FSDB_BYTES_PER_BIT_1B) into words and strings.
+// `bits[0]` is the most significant bit and every byte holds one of the VCD bit types 0(`0`), 1(`1`), 2(`X`) or 3(`Z`). The two-state conversions(`packWords`) read `X` and `Z` as zeros, the four-state ones(`packFourState`, `toBinStr`) follow the VPI encoding:
+//      `0` => aval 0, bval 0       `1` => aval 1, bval 0       `X` => aval 1, bval 1       `Z` => aval 0, bval 1
+// which is `aval = bit0 ^ bit1` and `bval = bit1` of the byte.
+//
+// Each conversion has a scalar(SWAR, 8 bits per step), an SSE2(16 bits per step) and an AVX2(32 bits per step) kernel. `bitConvert()` picks the widest one supported by the running CPU.
+#define BIT_CONVERT_VCD_1 1
+
+static_assert(std::endian::native == std::endian::little, "The SWAR kernels expect little-endian loads");
+
+struct BitConvertKernels {
+    const char *name;
+
+    // `words[0]` receives the 32 least significant bits, `words` must hold `(bitSize + 31) / 32` entries.
+    void (*packWords)(const uint8_t *bits, size_t bitSize, uint32_t *words);
+
+    // Interleaved `aval`/`bval` word pairs(the layout of `s_vpi_vecval`) in the `packWords` order, `vecvals` must hold `2 * ((bitSize + 31) / 32)` entries. Returns false if the value holds no `X`/`Z`(all `bval`s are zero).
+    bool (*packFourState)(const uint8_t *bits, size_t bitSize, uint32_t *vecvals);
+
+    // '0'/'1'/'x'/'z' characters, most significant bit first. `str` must hold `bitSize + 1` characters.
+    void (*toBinStr)(const uint8_t *bits, size_t bitSize, char *str);
+
+    // Lower-case hex digits of words produced by `packWords`, most significant digit first. `str` must hold `(bitSize + 3) / 4 + 1` characters.
+    void (*wordsToHexStr)(const uint32_t *words, size_t bitSize, char *str);
+};
+
+namespace bit_convert_detail {
+
+inline constexpr char hexDigits[] = "0123456789abcdef";
+
+// 8 byte-per-bit values => 8 bits, `p[0]` being the most significant one.
+inline uint32_t packByte(const uint8_t *p) {
+    uint64_t x;
+    std::memcpy(&x, p, sizeof(x));
+    uint64_t ones = x & ~(x >> 1) & 0x0101010101010101ULL; // Bit 0 of every byte is set iff the byte is `1`(values are at most 3)
+    return (ones * 0x8040201008040201ULL) >> 56;
+}
+
+// The first `end`(at most 32) bits => word, `bits[end - 1]` being bit 0.
+inline uint32_t packTail(const uint8_t *bits, size_t end) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < end; i++) {
+        value = (value << 1) | (bits[i] == BIT_CONVERT_VCD_1);
+    }
+    return value;
+}
+
+inline void packWordsScalar(const uint8_t *bits, size_t bitSize, uint32_t *words) {
+    size_t end = bitSize;
+    for (; end >= 32; end -= 32) {
+        auto p   = bits + end - 32;
+        *words++ = (packByte(p) << 24) | (packByte(p + 8) << 16) | (packByte(p + 16) << 8) | packByte(p + 24);
+    }
+    if (end != 0) {
+        *words = packTail(bits, end);
+    }
+}
+
+// 8 byte-per-bit values => 8 `aval` bits and 8 `bval` bits.
+inline void packFourStateByte(const uint8_t *p, uint32_t &aval, uint32_t &bval) {
+    uint64_t x;
+    std::memcpy(&x, p, sizeof(x));
+    uint64_t lo = x & 0x0101010101010101ULL;
+    uint64_t hi = (x >> 1) & 0x0101010101010101ULL;
+    aval        = ((lo ^ hi) * 0x8040201008040201ULL) >> 56;
+    bval        = (hi * 0x8040201008040201ULL) >> 56;
+}
+
+inline void packFourStateTail(const uint8_t *bits, size_t end, uint32_t &aval, uint32_t &bval) {
+    aval = 0;
+    bval = 0;
+    for (size_t i = 0; i < end; i++) {
+        aval = (aval << 1) | ((bits[i] ^ (bits[i] >> 1)) & 1);
+        bval = (bval << 1) | ((bits[i] >> 1) & 1);
+    }
+}
+
+inline bool packFourStateScalar(const uint8_t *bits, size_t bitSize, uint32_t *vecvals) {
+    uint32_t unknown = 0;
+    size_t end       = bitSize;
+    for (; end >= 32; end -= 32) {
+        auto p = bits + end - 32;
+        uint32_t a[4], b[4];
+        for (int k = 0; k < 4; k++) {
+            packFourStateByte(p + 8 * k, a[k], b[k]);
+        }
+        vecvals[0] = (a[0] << 24) | (a[1] << 16) | (a[2] << 8) | a[3];
+        vecvals[1] = (b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+        unknown |= vecvals[1];
+        vecvals += 2;
+    }
+    if (end != 0) {
+        packFourStateTail(bits, end, vecvals[0], vecvals[1]);
+        unknown |= vecvals[1];
+    }
+    return unknown != 0;
+}
+
+inline void toBinStrScalar(const uint8_t *bits, size_t bitSize, char *str) {
+    for (size_t i = 0; i < bitSize; i++) {
+        str[i] = "01xz"[bits[i] & 3];
+    }
+    str[bitSize] = '\0';
+}
+
+// Emit the `nibbleCnt` most significant digits one at a time, returns the advanced `str`.
+inline char *nibblesToHex(const uint32_t *words, size_t nibbleCnt, size_t skip, char *str) {
+    for (size_t n = nibbleCnt; n > skip; n--) {
+        size_t nibble = n - 1;
+        *str++        = hexDigits[(words[nibble >> 3] >> ((nibble & 7) * 4)) & 0xf];
+    }
+    return str;
+}
+
+inline void wordsToHexStrScalar(const uint32_t *words, size_t bitSize, char *str) {
+    size_t nibbleCnt = (bitSize + 3) / 4;
+    str              = nibblesToHex(words, nibbleCnt, 0, str);
+    *str             = '\0';
+}
+
+#ifdef BIT_CONVERT_X86
+// Reverse the bits of a 16-bit `movemask` result, whose bit 0 comes from the lowest address, i.e. the most significant value bit.
+inline uint32_t reverse16(uint32_t mask) {
+    static constexpr auto table = [] {
+        struct {
+            uint8_t v[256];
+        } t{};
+        for (int i = 0; i < 256; i++) {
+            uint8_t r = 0;
+            for (int b = 0; b < 8; b++) {
+                r |= ((i >> b) & 1) << (7 - b);
+            }
+            t.v[i] = r;
+        }
+        return t;
+    }();
+    return (table.v[mask & 0xff] << 8) | table.v[mask >> 8];
+}
+
+inline void packWordsSse2(const uint8_t *bits, size_t bitSize, uint32_t *words) {
+    const __m128i one = _mm_set1_epi8(BIT_CONVERT_VCD_1);
+    size_t end        = bitSize;
+    for (; end >= 32; end -= 32) {
+        auto hi  = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bits + end - 32)), one));
+        auto lo  = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bits + end - 16)), one));
+        *words++ = (reverse16(hi) << 16) | reverse16(lo);
+    }
+    if (end != 0) {
+        *words = packTail(bits, end);
+    }
+}
+
+inline bool packFourStateSse2(const uint8_t *bits, size_t bitSize, uint32_t *vecvals) {
+    const __m128i one = _mm_set1_epi8(BIT_CONVERT_VCD_1);
+    const __m128i two = _mm_set1_epi8(2);
+    uint32_t unknown  = 0;
+    size_t end        = bitSize;
+    for (; end >= 32; end -= 32) {
+        auto hi  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bits + end - 32));
+        auto lo  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bits + end - 16));
+        auto bHi = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(hi, two), two));
+        auto bLo = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, two), two));
+        auto aHi = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(hi, one), _mm_cmpeq_epi8(hi, two)));
+        auto aLo = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(lo, one), _mm_cmpeq_epi8(lo, two)));
+        vecvals[0] = (reverse16(aHi) << 16) | reverse16(aLo);
+        vecvals[1] = (reverse16(bHi) << 16) | reverse16(bLo);
+        unknown |= vecvals[1];
+        vecvals += 2;
+    }
+    if (end != 0) {
+        packFourStateTail(bits, end, vecvals[0], vecvals[1]);
+        unknown |= vecvals[1];
+    }
+    return unknown != 0;
+}
+
+inline void toBinStrSse2(const uint8_t *bits, size_t bitSize, char *str) {
+    const __m128i one  = _mm_set1_epi8(BIT_CONVERT_VCD_1);
+    const __m128i two  = _mm_set1_epi8(2);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i x    = _mm_set1_epi8('x');
+    size_t i           = 0;
+    for (; i + 16 <= bitSize; i += 16) {
+        auto v         = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bits + i));
+        auto known     = _mm_sub_epi8(zero, _mm_cmpeq_epi8(v, one)); // `cmpeq` is 0 or -1
+        auto isUnknown = _mm_cmpeq_epi8(_mm_and_si128(v, two), two);
+        auto unknown   = _mm_add_epi8(x, _mm_add_epi8(_mm_and_si128(v, one), _mm_and_si128(v, one))); // 'x' + 2 == 'z'
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(str + i), _mm_or_si128(_mm_andnot_si128(isUnknown, known), _mm_and_si128(isUnknown, unknown)));
+    }
+    toBinStrScalar(bits + i, bitSize - i, str + i);
+}
+
+// 16 nibbles of a 64-bit chunk => 16 digits with compare-and-add, SSE2 has no byte shuffle.
+inline void wordsToHexStrSse2(const uint32_t *words, size_t bitSize, char *str) {
+    const __m128i mask  = _mm_set1_epi8(0x0f);
+    const __m128i nine  = _mm_set1_epi8(9);
+    const __m128i zero  = _mm_set1_epi8('0');
+    const __m128i alpha = _mm_set1_epi8('a' - '0' - 10);
+
+    size_t nibbleCnt = (bitSize + 3) / 4;
+    size_t chunkCnt  = nibbleCnt / 16;
+    str              = nibblesToHex(words, nibbleCnt, chunkCnt * 16, str);
+    for (size_t c = chunkCnt; c > 0; c--) {
+        uint64_t chunk = words[2 * c - 2] | ((uint64_t)words[2 * c - 1] << 32);
+        auto x         = _mm_cvtsi64_si128(__builtin_bswap64(chunk));
+        auto nibbles   = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(x, 4), mask), _mm_and_si128(x, mask));
+        auto digits    = _mm_add_epi8(_mm_add_epi8(nibbles, zero), _mm_and_si128(_mm_cmpgt_epi8(nibbles, nine), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(str), digits);
+        str += 16;
+    }
+    *str = '\0';
+}
+
+__attribute__((target("avx2"))) inline void packWordsAvx2(const uint8_t *bits, size_t bitSize, uint32_t *words) {
+    const __m256i one = _mm256_set1_epi8(BIT_CONVERT_VCD_1);
+    // Reverse the 32 bytes so that `movemask` puts the last byte(the least significant bit) into bit 0
+    const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    size_t end            = bitSize;
+    for (; end >= 32; end -= 32) {
+        auto x   = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bits + end - 32));
+        x        = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(x, reverse), 0x4e);
+        *words++ = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, one));
+    }
+    if (end != 0) {
+        *words = packTail(bits, end);
+    }
+}
+
+__attribute__((target("avx2"))) inline bool packFourStateAvx2(const uint8_t *bits, size_t bitSize, uint32_t *vecvals) {
+    const __m256i one     = _mm256_set1_epi8(BIT_CONVERT_VCD_1);
+    const __m256i two     = _mm256_set1_epi8(2);
+    const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    uint32_t unknown      = 0;
+    size_t end            = bitSize;
+    for (; end >= 32; end -= 32) {
+        auto x     = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bits + end - 32));
+        x          = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(x, reverse), 0x4e);
+        vecvals[0] = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(x, one), _mm256_cmpeq_epi8(x, two)));
+        vecvals[1] = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(x, two), two));
+        unknown |= vecvals[1];
+        vecvals += 2;
+    }
+    if (end != 0) {
+        packFourStateTail(bits, end, vecvals[0], vecvals[1]);
+        unknown |= vecvals[1];
+    }
+    return unknown != 0;
+}
+
+__attribute__((target("avx2"))) inline void toBinStrAvx2(const uint8_t *bits, size_t bitSize, char *str) {
+    const __m256i table = _mm256_setr_epi8('0', '1', 'x', 'z', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '0', '1', 'x', 'z', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask  = _mm256_set1_epi8(3);
+    size_t i            = 0;
+    for (; i + 32 <= bitSize; i += 32) {
+        auto v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(bits + i)), mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(str + i), _mm256_shuffle_epi8(table, v));
+    }
+    toBinStrSse2(bits + i, bitSize - i, str + i);
+}
+
+// 32 nibbles of a 128-bit chunk => 32 digits through a `nibble => digit` byte shuffle.
+__attribute__((target("avx2"))) inline void wordsToHexStrAvx2(const uint32_t *words, size_t bitSize, char *str) {
+    const __m128i mask   = _mm_set1_epi8(0x0f);
+    const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hexDigits));
+    const __m128i swap   = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+    size_t nibbleCnt = (bitSize + 3) / 4;
+    size_t chunkCnt  = nibbleCnt / 32;
+    str              = nibblesToHex(words, nibbleCnt, chunkCnt * 32, str);
+    for (size_t c = chunkCnt; c > 0; c--) {
+        auto x  = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(words + 4 * c - 4)), swap); // Most significant byte first
+        auto hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+        auto lo = _mm_and_si128(x, mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(str), _mm_shuffle_epi8(digits, _mm_unpacklo_epi8(hi, lo)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(str + 16), _mm_shuffle_epi8(digits, _mm_unpackhi_epi8(hi, lo)));
+        str += 32;
+    }
+    *str = '\0';
+}
+#endif
+
+} // namespace bit_convert_detail
+
+inline constexpr BitConvertKernels bitConvertScalarKernels{"scalar", bit_convert_detail::packWordsScalar, bit_convert_detail::packFourStateScalar, bit_convert_detail::toBinStrScalar, bit_convert_detail::wordsToHexStrScalar};
+#ifdef BIT_CONVERT_X86
+inline constexpr BitConvertKernels bitConvertSse2Kernels{"sse2", bit_convert_detail::packWordsSse2, bit_convert_detail::packFourStateSse2, bit_convert_detail::toBinStrSse2, bit_convert_detail::wordsToHexStrSse2};
+inline constexpr BitConvertKernels bitConvertAvx2Kernels{"avx2", bit_convert_detail::packWordsAvx2, bit_convert_detail::packFourStateAvx2, bit_convert_detail::toBinStrAvx2, bit_convert_detail::wordsToHexStrAvx2};
+#endif
+
+// Hex digits of a four-state value given as `packFourState` word pairs, most significant digit first. A digit whose bits are all `X`(`Z`) is printed as 'x'('z'), a digit with some `X`(`Z`) bits as 'X'('Z').
+// Only used when `packFourState` found an unknown bit, known values go through `wordsToHexStr`.
+inline void fourStateWordsToHexStr(const uint32_t *vecvals, size_t bitSize, char *str) {
+    for (size_t n = (bitSize + 3) / 4; n > 0; n--) {
+        size_t nibble = n - 1;
+        size_t shift  = (nibble & 7) * 4;
+        uint32_t mask = nibble * 4 + 4 > bitSize ? (1U << (bitSize - nibble * 4)) - 1 : 0xf;
+        uint32_t a    = (vecvals[2 * (nibble >> 3)] >> shift) & mask;
+        uint32_t b    = (vecvals[2 * (nibble >> 3) + 1] >> shift) & mask;
+        if (b == 0) {
+            *str++ = bit_convert_detail::hexDigits[a];
+        } else if ((a & b) == mask) {
+            *str++ = 'x';
+        } else if ((~a & b) == mask) {
+            *str++ = 'z';
+        } else {
+            *str++ = (a & b) != 0 ? 'X' : 'Z';
+        }
+    }
+    *str = '\0';
+}
+
+// Kernels of the running CPU, resolved once.
+inline const BitConvertKernels &bitConvert() {
+    static const BitConvertKernels &kernels = []() -> const BitConvertKernels & {
+#ifdef BIT_CONVERT_X86
+        if (__builtin_cpu_supports("avx2")) {
+            return bitConvertAvx2Kernels;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return bitConvertSse2Kernels;
+        }
+#endif
+        return bitConvertScalarKernels;
+    }();
+    return kernels;
+}
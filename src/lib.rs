@@ -5,7 +5,7 @@ use byteorder::{BigEndian, ByteOrder};
 use bytesize::ByteSize;
 use serde::{Deserialize, Serialize};
 use std::borrow::Borrow;
-use std::collections::HashMap;
+use std::collections::{HashMap, HashSet};
 use std::ffi::{CStr, CString};
 use std::fs;
 use std::fs::File;
@@ -42,7 +42,14 @@ pub extern "C" fn create_vec() -> VecData {
     vec_data
 }
 
-static mut TIME_TABLE: Option<Vec<u64>> = None;
+// The time table is owned by the C++ side(see `TimeTable` in time_table.h) so that both backends share the same compressed representation.
+extern "C" {
+    fn wave_vpi_time_table_init(times: *const u64, size: usize);
+    fn wave_vpi_time_table_get(index: u64) -> u64;
+    fn wave_vpi_time_table_find_index(time: u64) -> u64;
+    fn wave_vpi_time_table_size() -> u64;
+}
+
 static mut HIERARCHY: Option<Hierarchy> = None;
 static mut WAVE_SOURCE: Option<SignalSource> = None;
 
@@ -51,6 +58,9 @@ const LOAD_OPTS: LoadOptions = LoadOptions {
     remove_scopes_with_empty_name: false,
 };
 
+// Cleared in the workers of a sharded replay(see `wellen_vpi_reopen`), a forked process does not have the thread pool of its parent.
+static mut LOAD_MULTI_THREAD: bool = LOAD_OPTS.multi_thread;
+
 #[allow(non_camel_case_types)]
 type vpiHandle = SignalRef;
 
@@ -95,11 +105,12 @@ pub extern "C" fn wellen_wave_init(filename: *const c_char) {
     println!("[wellen_wave_init] The hierarchy takes up at least {} of memory.", ByteSize::b(hierarchy.size_in_memory() as u64));
 
     unsafe {
-        TIME_TABLE = Some(body.time_table);
+        println!("[wellen_wave_init] Time table size: {}", body.time_table.len());
+        wave_vpi_time_table_init(body.time_table.as_ptr(), body.time_table.len());
+        drop(body.time_table);
+
         HIERARCHY = Some(hierarchy);
         WAVE_SOURCE = Some(wave_source);
-
-        println!("[wellen_wave_init] Time table size: {}", TIME_TABLE.clone().unwrap().len());
     }
 
     // If the wave file has not been modified, we can use the cached data to speed up the simulation.
@@ -224,7 +235,7 @@ pub unsafe extern "C" fn wellen_vpi_handle_by_name(name: *const c_char) -> *mut
             let signal_name = var.full_name(&HIERARCHY.as_ref().unwrap());
             if signal_name == name.to_string() {
                 let ids = [var.signal_ref(); 1];
-                let loaded = WAVE_SOURCE.as_mut().unwrap().load_signals(&ids, &HIERARCHY.as_ref().unwrap(), LOAD_OPTS.multi_thread);
+                let loaded = WAVE_SOURCE.as_mut().unwrap().load_signals(&ids, &HIERARCHY.as_ref().unwrap(), LOAD_MULTI_THREAD);
                 let (loaded_id, loaded_signal) = loaded.into_iter().next().unwrap();
                 assert_eq!(loaded_id, ids[0]);
 
@@ -252,69 +263,90 @@ pub unsafe extern "C" fn wellen_vpi_handle_by_name(name: *const c_char) -> *mut
     Box::into_raw(value) as *mut c_void
 }
 
+/// Called in a worker process right after `fork()`. FST signals are loaded lazily from the file, so the worker opens the file again instead of sharing the file offset with the other workers. VCD and GHW bodies are already in memory.
 #[no_mangle]
-pub extern "C" fn wellen_vpi_release_handle(_handle: *mut c_void) {
-    todo!();
-    // if !handle.is_null() {
-    //     unsafe {
-    //         Box::from_raw(_handle as *mut vpiHandle);
-    //     }
-    // }
+pub extern "C" fn wellen_vpi_reopen(filename: *const c_char) {
+    let filename = unsafe { CStr::from_ptr(filename) }.to_str().unwrap();
+    let opts = LoadOptions {
+        multi_thread: false,
+        ..LOAD_OPTS
+    };
+    unsafe {
+        LOAD_MULTI_THREAD = false;
+    }
+
+    let header = viewers::read_header(&filename, &opts).expect("Failed to load file!");
+    if !matches!(header.file_format, FileFormat::Fst) {
+        return;
+    }
+    let body = viewers::read_body(header.body, &header.hierarchy, None).expect("Failed to load body!");
+    unsafe {
+        // The old source belongs to the parent, leave it alone
+        if let Some(old) = WAVE_SOURCE.replace(body.source) {
+            std::mem::forget(old);
+        }
+    }
 }
 
-fn bytes_to_u32s_be(bytes: &[u8]) -> Vec<u32> {
-    let mut u32s = Vec::with_capacity((bytes.len() + 3) / 4);
+// Resolve and load a batch of signals with a single hierarchy traversal and a single `load_signals` call, which is multi-threaded inside wellen.
+#[no_mangle]
+pub unsafe extern "C" fn wellen_vpi_preload_signals(names: *const *const c_char, count: usize) {
+    assert!(!names.is_null() || count == 0);
+
+    let signal_ref_cache = SIGNAL_REF_CACHE.as_mut().unwrap();
+    let wanted: HashSet<String> = (0..count).map(|i| CStr::from_ptr(*names.add(i)).to_str().unwrap().to_string()).filter(|name| !signal_ref_cache.contains_key(name)).collect();
+    if wanted.is_empty() {
+        return;
+    }
 
-    let padded_bytes = if bytes.len() % 4 != 0 {
-        let ret = 4 - bytes.len() % 4;
-        match ret {
-            | 1 => [vec![0], bytes.to_vec()].concat(),
-            | 2 => [vec![0, 0], bytes.to_vec()].concat(),
-            | 3 => [vec![0, 0, 0], bytes.to_vec()].concat(),
-            | _ => unreachable!(),
+    let hier = HIERARCHY.as_ref().unwrap();
+    let mut found: Vec<(String, SignalRef)> = Vec::new();
+    let mut var_types: HashMap<SignalRef, VarType> = HashMap::new();
+    for var in hier.iter_vars() {
+        let full_name = var.full_name(hier);
+        if wanted.contains(&full_name) {
+            var_types.entry(var.signal_ref()).or_insert(var.var_type());
+            found.push((full_name, var.signal_ref()));
         }
-    } else {
-        Vec::from(bytes)
-    };
+    }
 
-    for chunk in padded_bytes.chunks(4) {
-        let value = BigEndian::read_u32(chunk);
-        u32s.push(value);
+    let signal_cache = SIGNAL_CACHE.as_mut().unwrap();
+    let ids: Vec<SignalRef> = var_types.keys().filter(|id| !signal_cache.contains_key(id)).cloned().collect();
+    let loaded = WAVE_SOURCE.as_mut().unwrap().load_signals(&ids, hier, LOAD_MULTI_THREAD);
+    for (loaded_id, loaded_signal) in loaded {
+        signal_cache.insert(
+            loaded_id,
+            SignalInfo {
+                signal: loaded_signal,
+                var_type: var_types[&loaded_id],
+            },
+        );
     }
 
-    u32s
+    if found.len() < wanted.len() {
+        println!("[wellen_vpi_preload_signals] some of the signals cannot be found, wanted: {} found: {}", wanted.len(), found.len());
+    }
+
+    for (name, id) in found {
+        signal_ref_cache.insert(name, id);
+    }
+    HAS_NEWLY_ADD_SIGNAL_REF = true;
+
+    println!("[wellen_vpi_preload_signals] preload {} signals", ids.len());
 }
 
-pub const fn cover_with_32(size: usize) -> usize {
-    (size + 31) / 32
+#[no_mangle]
+pub extern "C" fn wellen_vpi_release_handle(_handle: *mut c_void) {
+    todo!();
+    // if !handle.is_null() {
+    //     unsafe {
+    //         Box::from_raw(_handle as *mut vpiHandle);
+    //     }
+    // }
 }
 
-fn find_nearest_time_index(time_table: &[u64], time: u64) -> usize {
-    match time_table.binary_search_by(|&probe| {
-        if probe < time {
-            std::cmp::Ordering::Less
-        } else if probe > time {
-            std::cmp::Ordering::Greater
-        } else {
-            std::cmp::Ordering::Equal
-        }
-    }) {
-        | Ok(index) => index,
-        | Err(index) => {
-            if index == 0 {
-                0
-            } else if index == time_table.len() {
-                time_table.len() - 1
-            } else {
-                let before = index - 1;
-                if time_table[before] < time {
-                    before
-                } else {
-                    index
-                }
-            }
-        }
-    }
+pub const fn cover_with_32(size: usize) -> usize {
+    (size + 31) / 32
 }
 
 #[no_mangle]
@@ -326,66 +358,32 @@ pub unsafe extern "C" fn wellen_vpi_get_value_from_index(handle: *mut c_void, ti
     let off = loaded_signal.get_offset(time_table_idx as u32);
 
     if let Some(off) = off {
-        let _wave_time = TIME_TABLE.as_ref().unwrap()[time_table_idx as usize];
-        let mut signal_bit_string = loaded_signal.get_value_at(&off, 0).to_bit_string().unwrap();
+        let _wave_time = wave_vpi_time_table_get(time_table_idx);
         let signal_v = loaded_signal.get_value_at(&off, 0);
 
-        // TODO: performance
         match signal_v {
-            | SignalValue::Binary(data, _bits) => {
-                let words = bytes_to_u32s_be(data);
-                // println!("data => {:?} ww => {:?}   {}", data, words, words[words.len() - 1]);
-
+            | SignalValue::Binary(data, bits) => {
                 match v_format as u32 {
                     | vpiVectorVal => {
-                        let mut vecvals = Vec::new();
-                        for i in 0..words.len() {
-                            vecvals.insert(
-                                0,
-                                t_vpi_vecval {
-                                    aval: words[i] as i32,
-                                    bval: 0,
-                                },
-                            );
-                        }
-                        let vecvals_box = vecvals.into_boxed_slice();
-                        let vecvals_ptr = vecvals_box.as_ptr() as *mut t_vpi_vecval;
-                        let _ = Box::into_raw(vecvals_box);
-                        (*value_p).value.vector = vecvals_ptr;
+                        let vecvals = &mut VECVAL_BUFFER;
+                        vecvals.resize(cover_with_32(bits as usize).max(1), ZERO_VECVAL);
+                        binary_to_vecvals(data, vecvals);
+                        (*value_p).value.vector = vecvals.as_mut_ptr();
                     }
                     | vpiIntVal => {
-                        let value = words[words.len() - 1] as i32;
-                        (*value_p).value.integer = value;
+                        let value = data.rchunks(4).next().map_or(0, |chunk| chunk.iter().fold(0u32, |acc, &b| (acc << 8) | b as u32));
+                        (*value_p).value.integer = value as i32;
                     }
                     | vpiHexStrVal => {
-                        const chunk_size: u32 = 4;
-
-                        // Check if the length of `signal_bit_string` is not a multiple of 4
-                        if signal_bit_string.len() % 4 != 0 {
-                            let padding_length = 4 - (signal_bit_string.len() % 4);
-
-                            // Create a string of `'0'` characters with a length equal to `padding_length`
-                            let padding: String = std::iter::repeat('0').take(padding_length).collect();
-
-                            // Insert the padding at the beginning of the `signal_bit_string`
-                            signal_bit_string.insert_str(0, &padding);
-                        }
-
-                        let chunks: Vec<Vec<u8>> = signal_bit_string.as_bytes().chunks(chunk_size as usize).map(|chunk| chunk.iter().map(|&x| x - b'0').collect::<Vec<u8>>()).collect();
-                        let hex_string: String = chunks
-                            .iter()
-                            .map(|chunk| {
-                                let bin_value = chunk.iter().rev().enumerate().fold(0, |acc, (i, &b)| acc | (b << i));
-                                format!("{:x}", bin_value)
-                            })
-                            .collect();
-
-                        let c_string = CString::new(hex_string).expect("CString::new failed");
-                        let c_str_ptr = c_string.into_raw();
-                        (*value_p).value.str_ = c_str_ptr as *mut PLI_BYTE8;
-                        // todo!("vpiHexStrVal signal_bit_string => {} bits => {} hex_digits => {} {}", signal_bit_string, _bits, hex_digits, hex_string);
+                        let vecvals = &mut VECVAL_BUFFER;
+                        vecvals.resize(cover_with_32(bits as usize).max(1), ZERO_VECVAL);
+                        binary_to_vecvals(data, vecvals);
+                        let hex_string = &mut HEX_STR_BUFFER;
+                        vecvals_to_hex_string(vecvals, bits, false, hex_string);
+                        (*value_p).value.str_ = hex_string.as_mut_ptr() as *mut PLI_BYTE8;
                     }
                     | vpiBinStrVal => {
+                        let signal_bit_string = signal_v.to_bit_string().unwrap();
                         let c_string = CString::new(signal_bit_string).expect("CString::new failed");
                         let c_str_ptr = c_string.into_raw();
                         (*value_p).value.str_ = c_str_ptr as *mut PLI_BYTE8;
@@ -395,26 +393,26 @@ pub unsafe extern "C" fn wellen_vpi_get_value_from_index(handle: *mut c_void, ti
                     }
                 };
             }
-            | SignalValue::FourValue(_data, bits) => {
+            | SignalValue::FourValue(data, bits) => {
+                let vecvals = &mut VECVAL_BUFFER;
+                vecvals.resize(cover_with_32(bits as usize).max(1), ZERO_VECVAL);
+                let unknown = four_value_to_vecvals(data, vecvals);
+
                 match v_format as u32 {
                     | vpiVectorVal => {
-                        let vec_len = cover_with_32(bits as usize);
-                        let mut vecvals = Vec::new();
-                        for _i in 0..vec_len {
-                            vecvals.push(t_vpi_vecval {
-                                aval: 0,
-                                bval: 0,
-                            });
-                        }
-                        let vecvals_box = vecvals.into_boxed_slice();
-                        let vecvals_ptr = vecvals_box.as_ptr() as *mut t_vpi_vecval;
-                        let _ = Box::into_raw(vecvals_box);
-                        (*value_p).value.vector = vecvals_ptr;
+                        (*value_p).value.vector = vecvals.as_mut_ptr();
                     }
                     | vpiIntVal => {
-                        (*value_p).value.integer = 0;
+                        // treat `X`/`Z` as `0`
+                        (*value_p).value.integer = vecvals[0].aval & !vecvals[0].bval;
+                    }
+                    | vpiHexStrVal => {
+                        let hex_string = &mut HEX_STR_BUFFER;
+                        vecvals_to_hex_string(vecvals, bits, unknown, hex_string);
+                        (*value_p).value.str_ = hex_string.as_mut_ptr() as *mut PLI_BYTE8;
                     }
                     | vpiBinStrVal => {
+                        let signal_bit_string = signal_v.to_bit_string().unwrap();
                         let c_string = CString::new(signal_bit_string).expect("CString::new failed");
                         let c_str_ptr = c_string.into_raw();
                         (*value_p).value.str_ = c_str_ptr as *mut PLI_BYTE8;
@@ -433,18 +431,10 @@ pub unsafe extern "C" fn wellen_vpi_get_value_from_index(handle: *mut c_void, ti
 
         match v_format as u32 {
             | vpiVectorVal => {
-                let mut vecvals = Vec::new();
-                vecvals.insert(
-                    0,
-                    t_vpi_vecval {
-                        aval: 0,
-                        bval: 0,
-                    },
-                );
-                let vecvals_box = vecvals.into_boxed_slice();
-                let vecvals_ptr = vecvals_box.as_ptr() as *mut t_vpi_vecval;
-                let _ = Box::into_raw(vecvals_box);
-                (*value_p).value.vector = vecvals_ptr;
+                let vecvals = &mut VECVAL_BUFFER;
+                vecvals.clear();
+                vecvals.push(ZERO_VECVAL);
+                (*value_p).value.vector = vecvals.as_mut_ptr();
             }
             | vpiIntVal => {
                 (*value_p).value.integer = 0;
@@ -472,8 +462,222 @@ pub unsafe extern "C" fn wellen_vpi_get_value_from_index(handle: *mut c_void, ti
 
 #[no_mangle]
 pub unsafe extern "C" fn wellen_vpi_get_value(handle: *mut c_void, time: u64, value_p: p_vpi_value) {
-    let time_table_idx = find_nearest_time_index(TIME_TABLE.as_ref().unwrap(), time);
-    wellen_vpi_get_value_from_index(handle, time_table_idx as u64, value_p);
+    let time_table_idx = wave_vpi_time_table_find_index(time);
+    wellen_vpi_get_value_from_index(handle, time_table_idx, value_p);
+}
+
+// Reused by `wellen_vpi_get_value_from_index`, the results stay valid until the next call.
+static mut VECVAL_BUFFER: Vec<t_vpi_vecval> = Vec::new();
+static mut HEX_STR_BUFFER: Vec<u8> = Vec::new();
+
+const ZERO_VECVAL: t_vpi_vecval = t_vpi_vecval {
+    aval: 0,
+    bval: 0,
+};
+
+/// Write the value of `handle` at `time_table_idx` into the `len` words at `vecvals`, least significant word first, so that the caller can keep one right-sized buffer per signal instead of going through `VECVAL_BUFFER`.
+/// `len` must cover the width of the signal. Returns true if any bit is `X`/`Z`.
+#[no_mangle]
+pub unsafe extern "C" fn wellen_vpi_get_vector_from_index(handle: *mut c_void, time_table_idx: u64, vecvals: *mut t_vpi_vecval, len: usize) -> bool {
+    let handle = unsafe { *{ handle as *mut vpiHandle } };
+    let vecvals = std::slice::from_raw_parts_mut(vecvals, len);
+
+    let loaded_signal = SIGNAL_CACHE.as_ref().unwrap().get(&(handle as vpiHandle)).unwrap().signal.borrow();
+    signal_to_vecvals(loaded_signal, time_table_idx, vecvals)
+}
+
+/// Same as `wellen_vpi_get_vector_from_index`, and also writes the range `[span[0], span[1])` of indices over which the value holds(`span[1]` is `u64::MAX` after the last change), so that the caller can keep the value until it leaves the range.
+/// It only reads the loaded signal and may be called from several threads at once, as long as no handle is created meanwhile.
+#[no_mangle]
+pub unsafe extern "C" fn wellen_vpi_get_vector_span(handle: *mut c_void, time_table_idx: u64, vecvals: *mut t_vpi_vecval, len: usize, span: *mut u64) -> bool {
+    let handle = unsafe { *{ handle as *mut vpiHandle } };
+    let vecvals = std::slice::from_raw_parts_mut(vecvals, len);
+    let span = std::slice::from_raw_parts_mut(span, 2);
+
+    let loaded_signal = SIGNAL_CACHE.as_ref().unwrap().get(&(handle as vpiHandle)).unwrap().signal.borrow();
+    let time_indices = loaded_signal.time_indices();
+    let pos = time_indices.partition_point(|&idx| idx as u64 <= time_table_idx);
+    span[0] = if pos == 0 {
+        0
+    } else {
+        time_indices[pos - 1] as u64
+    };
+    span[1] = if pos < time_indices.len() {
+        time_indices[pos] as u64
+    } else {
+        u64::MAX
+    };
+    signal_to_vecvals(loaded_signal, time_table_idx, vecvals)
+}
+
+/// Call `callback(context, time_table_idx, vecvals)` with the value of `handle` at `start_idx` and then with every change in (`start_idx`, `end_idx`) until it returns false, so that a range is decoded once per change instead of once per index.
+/// `vecvals` holds `len` words(see `wellen_vpi_get_vector_from_index`) and is only valid during the call.
+#[no_mangle]
+pub unsafe extern "C" fn wellen_vpi_iter_vector_range(handle: *mut c_void, start_idx: u64, end_idx: u64, len: usize, context: *mut c_void, callback: extern "C" fn(*mut c_void, u64, *const t_vpi_vecval) -> bool) {
+    let handle = unsafe { *{ handle as *mut vpiHandle } };
+    let loaded_signal = SIGNAL_CACHE.as_ref().unwrap().get(&(handle as vpiHandle)).unwrap().signal.borrow();
+    let mut vecvals = vec![ZERO_VECVAL; len];
+
+    signal_to_vecvals(loaded_signal, start_idx, &mut vecvals);
+    if !callback(context, start_idx, vecvals.as_ptr()) {
+        return;
+    }
+
+    let time_indices = loaded_signal.time_indices();
+    let first = time_indices.partition_point(|&idx| idx as u64 <= start_idx);
+    for &idx in &time_indices[first..] {
+        if idx as u64 >= end_idx {
+            break;
+        }
+        signal_to_vecvals(loaded_signal, idx as u64, &mut vecvals);
+        if !callback(context, idx as u64, vecvals.as_ptr()) {
+            break;
+        }
+    }
+}
+
+/// Backward counterpart of `wellen_vpi_iter_vector_range`: call `callback(context, time_table_idx, vecvals)` with every change of `handle` at or before `from_idx`, latest first, until it returns false.
+/// Unlike the forward walk, `time_table_idx` is always the index of a real change and the value before the first change is not reported(it is 0).
+#[no_mangle]
+pub unsafe extern "C" fn wellen_vpi_iter_vector_range_rev(handle: *mut c_void, from_idx: u64, len: usize, context: *mut c_void, callback: extern "C" fn(*mut c_void, u64, *const t_vpi_vecval) -> bool) {
+    let handle = unsafe { *{ handle as *mut vpiHandle } };
+    let loaded_signal = SIGNAL_CACHE.as_ref().unwrap().get(&(handle as vpiHandle)).unwrap().signal.borrow();
+    let mut vecvals = vec![ZERO_VECVAL; len];
+
+    let time_indices = loaded_signal.time_indices();
+    let end = time_indices.partition_point(|&idx| idx as u64 <= from_idx);
+    for &idx in time_indices[..end].iter().rev() {
+        signal_to_vecvals(loaded_signal, idx as u64, &mut vecvals);
+        if !callback(context, idx as u64, vecvals.as_ptr()) {
+            break;
+        }
+    }
+}
+
+// Value of `loaded_signal` at `time_table_idx` in VPI `aval`/`bval` words, returns true if any bit is `X`/`Z`.
+fn signal_to_vecvals(loaded_signal: &Signal, time_table_idx: u64, vecvals: &mut [t_vpi_vecval]) -> bool {
+    match loaded_signal.get_offset(time_table_idx as u32) {
+        | Some(off) => match loaded_signal.get_value_at(&off, 0) {
+            | SignalValue::Binary(data, _bits) => {
+                binary_to_vecvals(data, vecvals);
+                false
+            }
+            | SignalValue::FourValue(data, _bits) => four_value_to_vecvals(data, vecvals),
+            | signal_v => panic!("{:#?}", signal_v),
+        },
+        | None => {
+            // No value found at time index 0, use default value: 0
+            vecvals.fill(ZERO_VECVAL);
+            false
+        }
+    }
+}
+
+/// Decode a `SignalValue::Binary` into VPI `aval` words, least significant word first. One pass over `data` and no allocation, the words of `vecvals` beyond the value are cleared.
+fn binary_to_vecvals(data: &[u8], vecvals: &mut [t_vpi_vecval]) {
+    let mut chunks = data.rchunks(4);
+    for vecval in vecvals.iter_mut() {
+        let aval = chunks.next().map_or(0, |chunk| chunk.iter().fold(0u32, |acc, &b| (acc << 8) | b as u32));
+        *vecval = t_vpi_vecval {
+            aval: aval as i32,
+            bval: 0,
+        };
+    }
+}
+
+// Gather the even bits of `x` into a word.
+#[inline]
+fn compact_even_bits(x: u64) -> u32 {
+    let mut x = x & 0x5555_5555_5555_5555;
+    x = (x | (x >> 1)) & 0x3333_3333_3333_3333;
+    x = (x | (x >> 2)) & 0x0f0f_0f0f_0f0f_0f0f;
+    x = (x | (x >> 4)) & 0x00ff_00ff_00ff_00ff;
+    x = (x | (x >> 8)) & 0x0000_ffff_0000_ffff;
+    x = (x | (x >> 16)) & 0x0000_0000_ffff_ffff;
+    x as u32
+}
+
+/// Decode a `SignalValue::FourValue` into VPI `aval`/`bval` words, least significant word first. Returns false if no bit is `X`/`Z`.
+/// wellen packs two bits per bit, most significant bit first: 0 => `0`, 1 => `1`, 2 => `X`, 3 => `Z`. With `lo`/`hi` being the two bits, `aval = lo ^ hi` and `bval = hi`.
+/// Every 8 bytes are deinterleaved into one 32-bit word at once, and a word without `X`/`Z`(no `hi` bit set) only needs its `lo` bits.
+fn four_value_to_vecvals(data: &[u8], vecvals: &mut [t_vpi_vecval]) -> bool {
+    let mut unknown = false;
+    let mut chunks = data.rchunks(8);
+    for vecval in vecvals.iter_mut() {
+        let x = match chunks.next() {
+            | Some(chunk) if chunk.len() == 8 => BigEndian::read_u64(chunk),
+            | Some(chunk) => chunk.iter().fold(0u64, |acc, &b| (acc << 8) | b as u64),
+            | None => 0,
+        };
+        let (aval, bval) = if x & 0xaaaa_aaaa_aaaa_aaaa == 0 {
+            (compact_even_bits(x), 0)
+        } else {
+            unknown = true;
+            let lo = compact_even_bits(x);
+            let hi = compact_even_bits(x >> 1);
+            (lo ^ hi, hi)
+        };
+        *vecval = t_vpi_vecval {
+            aval: aval as i32,
+            bval: bval as i32,
+        };
+    }
+    unknown
+}
+
+/// NUL-terminated hex digits of `vecvals`, most significant digit first. A digit whose bits are all `X`(`Z`) is 'x'('z'), a digit with some `X`(`Z`) bits is 'X'('Z').
+fn vecvals_to_hex_string(vecvals: &[t_vpi_vecval], bits: u32, unknown: bool, out: &mut Vec<u8>) {
+    const HEX_DIGITS: &[u8; 16] = b"0123456789abcdef";
+    out.clear();
+    for nibble in (0..(bits as usize + 3) / 4).rev() {
+        let shift = (nibble % 8) * 4;
+        let mask = if nibble * 4 + 4 > bits as usize {
+            (1u32 << (bits as usize - nibble * 4)) - 1
+        } else {
+            0xf
+        };
+        let a = (vecvals[nibble / 8].aval as u32 >> shift) & mask;
+        let b = if unknown {
+            (vecvals[nibble / 8].bval as u32 >> shift) & mask
+        } else {
+            0
+        };
+        out.push(match b {
+            | 0 => HEX_DIGITS[a as usize],
+            | _ if a & b == mask => b'x',
+            | _ if !a & b == mask => b'z',
+            | _ if a & b != 0 => b'X',
+            | _ => b'Z',
+        });
+    }
+    out.push(0);
+}
+
+// Lower 64 bits of a value with `X`/`Z` read as `0`, and whether any bit is `X`/`Z`.
+fn signal_value_to_u64(signal_v: &SignalValue) -> (u64, bool) {
+    match *signal_v {
+        | SignalValue::Binary(data, _bits) => (data.iter().fold(0u64, |acc, &b| (acc << 8) | b as u64), false),
+        | SignalValue::FourValue(data, _bits) => {
+            // Two bits per bit: 0 => `0`, 1 => `1`, 2 => `X`, 3 => `Z`
+            let value = data.iter().fold(0u64, |acc, &b| (0..4).rev().fold(acc, |acc, i| (acc << 1) | (((b >> (i * 2)) & 0b11) == 1) as u64));
+            (value, data.iter().any(|&b| b & 0xaa != 0))
+        }
+        | _ => panic!("{:#?}", signal_v),
+    }
+}
+
+/// Walk the value changes of `handle` and call `callback(context, time_table_idx, value, unknown)` for each of them until it returns false, see `signal_value_to_u64` for the value.
+#[no_mangle]
+pub unsafe extern "C" fn wellen_vpi_iter_changes(handle: *mut c_void, context: *mut c_void, callback: extern "C" fn(*mut c_void, u64, u64, bool) -> bool) {
+    let handle = unsafe { *{ handle as *mut vpiHandle } };
+    let loaded_signal = SIGNAL_CACHE.as_ref().unwrap().get(&(handle as vpiHandle)).unwrap().signal.borrow();
+
+    for (time_table_idx, signal_v) in loaded_signal.iter_changes() {
+        let (value, unknown) = signal_value_to_u64(&signal_v);
+        if !callback(context, time_table_idx as u64, value, unknown) {
+            break;
+        }
+    }
 }
 
 #[no_mangle]
@@ -572,19 +776,17 @@ pub unsafe extern "C" fn wellen_vpi_iterate(_type: PLI_INT32, refHandle: *mut c_
 
 #[no_mangle]
 pub extern "C" fn wellen_get_time_from_index(index: u64) -> u64 {
-    let time_table = unsafe { TIME_TABLE.as_ref().unwrap() };
-    time_table[index as usize]
+    unsafe { wave_vpi_time_table_get(index) }
 }
 
 #[no_mangle]
 pub extern "C" fn wellen_get_index_from_time(time: u64) -> u64 {
-    let time_table = unsafe { TIME_TABLE.as_ref().unwrap() };
-    find_nearest_time_index(time_table, time) as u64
+    unsafe { wave_vpi_time_table_find_index(time) }
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn wellen_get_max_index() -> u64 {
-    (TIME_TABLE.as_ref().unwrap().len() - 1) as u64
+    wave_vpi_time_table_size() - 1
 }
 
 #[no_mangle]
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Times are grouped into blocks of TIME_TABLE_BLOCK_SIZE entries, every block is encoded on its own so that any entry can be decoded without touching the other blocks.
+#define TIME_TABLE_BLOCK_SHIFT 6
+#define TIME_TABLE_BLOCK_SIZE (1 << TIME_TABLE_BLOCK_SHIFT)
+#define TIME_TABLE_BLOCK_MASK (TIME_TABLE_BLOCK_SIZE - 1)
+
+// Compressed, monotone (non-decreasing) time table.
+// The j-th time of a block is stored as `base + j * stride + residual[j]`, where `base` is the first time of the block and `stride` is the smallest distance between two neighbouring times of the block. The residuals are bit-packed with the width of the largest one. A periodic clock has all its residuals equal to zero and costs only the block header, an irregular time table costs about log2(max residual) bits per entry instead of 64.
+//
+// Index => time is O(1). Time => index is O(log(distance)) when a hint close to the result is given (e.g. the current cursor index), and O(log(n)) otherwise.
+class TimeTable {
+  public:
+    void clear() {
+        blocks.clear();
+        words.clear();
+        pending.clear();
+        count = 0;
+    }
+
+    // Times must be appended in non-decreasing order, `finish` must be called after the last one.
+    void push_back(uint64_t time) {
+        pending.push_back(time);
+        count++;
+        if (pending.size() == TIME_TABLE_BLOCK_SIZE) {
+            flush();
+        }
+    }
+
+    void finish() {
+        if (!pending.empty()) {
+            flush();
+        }
+        blocks.shrink_to_fit();
+        words.shrink_to_fit();
+    }
+
+    void build(const std::vector<uint64_t> &times) {
+        clear();
+        blocks.reserve((times.size() + TIME_TABLE_BLOCK_MASK) >> TIME_TABLE_BLOCK_SHIFT);
+        for (auto time : times) {
+            push_back(time);
+        }
+        finish();
+    }
+
+    inline uint64_t get(uint64_t idx) const {
+        auto &block = blocks[idx >> TIME_TABLE_BLOCK_SHIFT];
+        uint64_t j  = idx & TIME_TABLE_BLOCK_MASK;
+        return block.base + j * block.stride + unpack(block.wordOffset, block.width, j);
+    }
+
+    inline uint64_t operator[](uint64_t idx) const { return get(idx); }
+    uint64_t back() const { return get(count - 1); }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Index of the last time that is less than or equal to `time`, clamped into [0, size() - 1].
+    uint64_t findIndex(uint64_t time, uint64_t hint = 0) const {
+        if (count == 0) {
+            return 0;
+        }
+        hint = std::min<uint64_t>(hint, count - 1);
+
+        uint64_t lo, hi; // The result is in [lo, hi)
+        if (get(hint) <= time) {
+            // Gallop forward from the hint
+            uint64_t step = 1;
+            lo            = hint;
+            while (true) {
+                uint64_t probe = lo + step;
+                if (probe >= count) {
+                    hi = count;
+                    break;
+                }
+                if (get(probe) > time) {
+                    hi = probe;
+                    break;
+                }
+                lo = probe;
+                step <<= 1;
+            }
+        } else {
+            // Gallop backward from the hint
+            uint64_t step = 1;
+            hi            = hint;
+            while (true) {
+                if (hi <= step) {
+                    lo = 0;
+                    break;
+                }
+                uint64_t probe = hi - step;
+                if (get(probe) <= time) {
+                    lo = probe;
+                    break;
+                }
+                hi = probe;
+                step <<= 1;
+            }
+            if (lo == 0 && get(0) > time) {
+                return 0;
+            }
+        }
+
+        // Invariant: get(lo) <= time and get(hi) > time (or hi == count)
+        while (hi - lo > 1) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (get(mid) <= time) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    size_t memoryUsage() const { return blocks.capacity() * sizeof(Block) + words.capacity() * sizeof(uint64_t); }
+
+  private:
+    struct Block {
+        uint64_t base;
+        uint64_t stride;
+        uint64_t wordOffset : 56;
+        uint64_t width : 8;
+    };
+
+    void flush() {
+        Block block;
+        block.base   = pending[0];
+        block.stride = UINT64_MAX;
+        for (size_t j = 1; j < pending.size(); j++) {
+            block.stride = std::min(block.stride, pending[j] - pending[j - 1]);
+        }
+        if (pending.size() == 1) {
+            block.stride = 0;
+        }
+
+        uint64_t maxResidual = 0;
+        for (size_t j = 0; j < pending.size(); j++) {
+            maxResidual = std::max(maxResidual, pending[j] - block.base - j * block.stride);
+        }
+        uint64_t width = 0;
+        while (width < 64 && (maxResidual >> width) != 0) {
+            width++;
+        }
+        block.width      = width;
+        block.wordOffset = words.size();
+
+        if (width != 0) {
+            words.resize(words.size() + ((pending.size() * width + 63) >> 6), 0);
+            for (size_t j = 0; j < pending.size(); j++) {
+                uint64_t residual = pending[j] - block.base - j * block.stride;
+                uint64_t bitPos   = j * width;
+                uint64_t wordIdx  = block.wordOffset + (bitPos >> 6);
+                uint64_t shift    = bitPos & 63;
+                words[wordIdx] |= residual << shift;
+                if (shift + width > 64) {
+                    words[wordIdx + 1] |= residual >> (64 - shift);
+                }
+            }
+        }
+
+        blocks.push_back(block);
+        pending.clear();
+    }
+
+    inline uint64_t unpack(uint64_t wordOffset, uint64_t width, uint64_t j) const {
+        if (width == 0) {
+            return 0;
+        }
+        uint64_t bitPos  = j * width;
+        uint64_t wordIdx = wordOffset + (bitPos >> 6);
+        uint64_t shift   = bitPos & 63;
+        uint64_t value   = words[wordIdx] >> shift;
+        if (shift + width > 64) {
+            value |= words[wordIdx + 1] << (64 - shift);
+        }
+        return width == 64 ? value : (value & ((1ULL << width) - 1));
+    }
+
+    std::vector<Block> blocks;
+    std::vector<uint64_t> words;
+    std::vector<uint64_t> pending; // Times of the last block that are not encoded yet
+    size_t count = 0;
+};
@@ -0,0 +1,603 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Values are grouped into blocks of VALUE_STORE_BLOCK_SIZE time-table indices. Writers are expected to publish whole blocks (see `alignToBlock`) so that a reader never touches the block that is being written.
+#define VALUE_STORE_BLOCK_SHIFT 10
+#define VALUE_STORE_BLOCK_SIZE (1 << VALUE_STORE_BLOCK_SHIFT)
+#define VALUE_STORE_BLOCK_MASK (VALUE_STORE_BLOCK_SIZE - 1)
+
+inline uint64_t alignToBlock(uint64_t idx) { return (idx + VALUE_STORE_BLOCK_MASK) & ~(uint64_t)VALUE_STORE_BLOCK_MASK; }
+
+enum class SignalEdge { Posedge, Negedge, Any };
+
+// An edge of a multi-bit value is a change from/to zero, `Any` is any change.
+template <typename T> inline bool isEdge(T prev, T value, SignalEdge edge) {
+    return value != prev && (edge == SignalEdge::Any || (value != 0) == (edge == SignalEdge::Posedge));
+}
+
+// Memory budget shared by all the value stores. A store whose layout does not fit takes a smaller layout or is not built at all, in which case the signal keeps being read from the wave backend.
+class ValueStoreBudget {
+  public:
+    uint64_t limit = UINT64_MAX;
+
+    bool reserve(uint64_t bytes) {
+        uint64_t current = used.load(std::memory_order_relaxed);
+        do {
+            if (current + bytes > limit) {
+                return false;
+            }
+        } while (!used.compare_exchange_weak(current, current + bytes, std::memory_order_relaxed));
+        return true;
+    }
+
+    void release(uint64_t bytes) { used.fetch_sub(std::min(bytes, getUsed()), std::memory_order_relaxed); }
+
+    uint64_t getUsed() const { return used.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint64_t> used = 0;
+};
+
+// Change-point encoded array indexed by time-table index.
+// Every block keeps its own list of (offset, value) pairs, one pair per value change. The first value written into a block is always recorded so that a lookup never has to look into the previous block.
+template <typename T> class ChangePointVec {
+  public:
+    void init(size_t size) {
+        blocks.clear();
+        blocks.resize((size + VALUE_STORE_BLOCK_MASK) >> VALUE_STORE_BLOCK_SHIFT);
+        hintBlock = 0;
+        hintPos   = 0;
+    }
+
+    // Indices must be written in increasing order.
+    void set(uint64_t idx, T value) {
+        auto &block     = blocks[idx >> VALUE_STORE_BLOCK_SHIFT];
+        uint16_t offset = idx & VALUE_STORE_BLOCK_MASK;
+        if (!block.offsets.empty() && block.values.back() == value) {
+            return;
+        }
+        block.offsets.push_back(offset);
+        block.values.push_back(value);
+    }
+
+    // Release the slack of the blocks in [startIdx, finishIdx). Must be called before these blocks are made visible to the reader.
+    void seal(uint64_t startIdx, uint64_t finishIdx) {
+        for (auto blockIdx = startIdx >> VALUE_STORE_BLOCK_SHIFT; blockIdx < std::min((uint64_t)blocks.size(), (finishIdx + VALUE_STORE_BLOCK_MASK) >> VALUE_STORE_BLOCK_SHIFT); blockIdx++) {
+            blocks[blockIdx].offsets.shrink_to_fit();
+            blocks[blockIdx].values.shrink_to_fit();
+        }
+    }
+
+    // `indices[i]` is the first index holding `values[i]`, `indices` must be increasing and `indices[0]` must be 0.
+    template <typename V> void build(const std::vector<uint64_t> &indices, const std::vector<V> &values, size_t size) {
+        init(size);
+        size_t c = 0;
+        for (uint64_t blockIdx = 0; blockIdx < blocks.size(); blockIdx++) {
+            uint64_t blockStart = blockIdx << VALUE_STORE_BLOCK_SHIFT;
+            uint64_t blockEnd   = std::min<uint64_t>(size, blockStart + VALUE_STORE_BLOCK_SIZE);
+            while (c + 1 < indices.size() && indices[c + 1] <= blockStart) {
+                c++;
+            }
+            set(blockStart, static_cast<T>(values[c]));
+            while (c + 1 < indices.size() && indices[c + 1] < blockEnd) {
+                c++;
+                set(indices[c], static_cast<T>(values[c]));
+            }
+        }
+        seal(0, size);
+    }
+
+    // Amortized O(1) when `idx` moves forward, which is the common case for the replay cursor.
+    T get(uint64_t idx) const {
+        uint64_t blockIdx = idx >> VALUE_STORE_BLOCK_SHIFT;
+        uint16_t offset   = idx & VALUE_STORE_BLOCK_MASK;
+        auto &block       = blocks[blockIdx];
+        auto &offsets     = block.offsets;
+
+        if (blockIdx != hintBlock || hintPos >= offsets.size() || offsets[hintPos] > offset) [[unlikely]] {
+            auto it   = std::upper_bound(offsets.begin(), offsets.end(), offset);
+            hintPos   = it == offsets.begin() ? 0 : (it - offsets.begin() - 1);
+            hintBlock = blockIdx;
+        } else {
+            while (hintPos + 1 < offsets.size() && offsets[hintPos + 1] <= offset) {
+                hintPos++;
+            }
+        }
+        return block.values[hintPos];
+    }
+
+    // First index after `idx` at which `edge` happens, UINT64_MAX if there is none. Only the recorded change points are visited.
+    uint64_t nextEdge(uint64_t idx, SignalEdge edge) const {
+        T prev            = get(idx);
+        uint64_t blockIdx = idx >> VALUE_STORE_BLOCK_SHIFT;
+        size_t pos        = hintPos + 1;
+        for (; blockIdx < blocks.size(); blockIdx++, pos = 0) {
+            auto &block = blocks[blockIdx];
+            for (; pos < block.offsets.size(); pos++) {
+                T value = block.values[pos];
+                if (isEdge(prev, value, edge)) {
+                    return (blockIdx << VALUE_STORE_BLOCK_SHIFT) + block.offsets[pos];
+                }
+                prev = value;
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    // Last index at or before `idx` at which `edge` happens, UINT64_MAX if there is none. The first entry of a block is compared with the last entry of the previous block since it is not necessarily a change.
+    uint64_t prevEdge(uint64_t idx, SignalEdge edge) const {
+        get(idx);
+        uint64_t blockIdx = hintBlock;
+        size_t pos        = hintPos;
+        while (true) {
+            auto &block = blocks[blockIdx];
+            if (pos == 0 && blockIdx == 0) {
+                return UINT64_MAX;
+            }
+            T prev = pos > 0 ? block.values[pos - 1] : blocks[blockIdx - 1].values.back();
+            if (isEdge(prev, block.values[pos], edge)) {
+                return (blockIdx << VALUE_STORE_BLOCK_SHIFT) + block.offsets[pos];
+            }
+            if (pos > 0) {
+                pos--;
+            } else {
+                blockIdx--;
+                pos = blocks[blockIdx].offsets.size() - 1;
+            }
+        }
+    }
+
+    size_t changeCount() const {
+        size_t cnt = 0;
+        for (auto &block : blocks) {
+            cnt += block.offsets.size();
+        }
+        return cnt;
+    }
+
+    size_t memoryUsage() const {
+        size_t bytes = blocks.capacity() * sizeof(Block);
+        for (auto &block : blocks) {
+            bytes += block.offsets.capacity() * sizeof(uint16_t) + block.values.capacity() * sizeof(T);
+        }
+        return bytes;
+    }
+
+  private:
+    struct Block {
+        std::vector<uint16_t> offsets;
+        std::vector<T> values;
+    };
+
+    std::vector<Block> blocks;
+
+    mutable uint64_t hintBlock = 0;
+    mutable size_t hintPos     = 0;
+};
+
+// Plain value-per-index array. The storage is left uninitialized so that untouched pages are never committed.
+template <typename T> class DenseVec {
+  public:
+    void init(size_t size) {
+        data.reset(new T[size]);
+        this->size = size;
+    }
+
+    template <typename V> void build(const std::vector<uint64_t> &indices, const std::vector<V> &values, size_t size) {
+        init(size);
+        for (size_t i = 0; i < indices.size(); i++) {
+            std::fill(data.get() + indices[i], data.get() + (i + 1 < indices.size() ? indices[i + 1] : size), static_cast<T>(values[i]));
+        }
+    }
+
+    void set(uint64_t idx, T value) { data[idx] = value; }
+    T get(uint64_t idx) const { return data[idx]; }
+
+    // A scan over every index, which is fine since `AdaptiveValueVec::chooseLayout` only keeps the dense layout for signals that change at a large fraction of the indices.
+    uint64_t nextEdge(uint64_t idx, SignalEdge edge) const {
+        for (uint64_t i = idx + 1; i < size; i++) {
+            if (isEdge(data[i - 1], data[i], edge)) {
+                return i;
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    uint64_t prevEdge(uint64_t idx, SignalEdge edge) const {
+        for (uint64_t i = std::min<uint64_t>(idx + 1, size); i-- > 1;) {
+            if (isEdge(data[i - 1], data[i], edge)) {
+                return i;
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    size_t memoryUsage() const { return size * sizeof(T); }
+
+  private:
+    std::unique_ptr<T[]> data;
+    size_t size = 0;
+};
+
+// Bit-packed values of a 1-bit signal, one bit per time-table index and 64 indices per word.
+// A read is a shift-and-mask, and the next edge is found a word at a time by comparing every bit with its predecessor.
+class BitVec {
+  public:
+    void init(size_t size) {
+        this->size = size;
+        words.assign((size + 63) >> 6, 0);
+    }
+
+    // `indices[i]` is the first index holding `values[i]`, `indices` must be increasing.
+    template <typename V> void build(const std::vector<uint64_t> &indices, const std::vector<V> &values, size_t size) {
+        init(size);
+        for (size_t i = 0; i < indices.size(); i++) {
+            if (values[i] & 1) {
+                setRange(indices[i], i + 1 < indices.size() ? indices[i + 1] : size);
+            }
+        }
+    }
+
+    inline void set(uint64_t idx, uint32_t value) {
+        if (value & 1) {
+            words[idx >> 6] |= 1ULL << (idx & 63);
+        } else {
+            words[idx >> 6] &= ~(1ULL << (idx & 63));
+        }
+    }
+
+    inline uint32_t get(uint64_t idx) const { return (words[idx >> 6] >> (idx & 63)) & 1; }
+
+    // First index after `idx` at which `edge` happens, UINT64_MAX if there is none.
+    uint64_t nextEdge(uint64_t idx, SignalEdge edge) const {
+        uint64_t start = idx + 1;
+        if (start >= size) {
+            return UINT64_MAX;
+        }
+
+        uint64_t mask = ~0ULL << (start & 63);
+        for (uint64_t w = start >> 6; w < words.size(); w++) {
+            uint64_t cur  = words[w];
+            uint64_t prev = (cur << 1) | (w == 0 ? (cur & 1) : (words[w - 1] >> 63)); // Bit j holds the value at index j - 1
+            uint64_t diff = (cur ^ prev) & mask;
+            if (edge == SignalEdge::Posedge) {
+                diff &= cur;
+            } else if (edge == SignalEdge::Negedge) {
+                diff &= ~cur;
+            }
+            mask = ~0ULL;
+
+            if (diff != 0) {
+                uint64_t edgeIdx = (w << 6) + std::countr_zero(diff);
+                return edgeIdx < size ? edgeIdx : UINT64_MAX;
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    // Last index at or before `idx` at which `edge` happens, UINT64_MAX if there is none.
+    uint64_t prevEdge(uint64_t idx, SignalEdge edge) const {
+        if (size == 0) {
+            return UINT64_MAX;
+        }
+        idx = std::min(idx, size - 1);
+
+        uint64_t mask = (idx & 63) == 63 ? ~0ULL : ((1ULL << ((idx & 63) + 1)) - 1);
+        for (uint64_t w = (idx >> 6) + 1; w-- > 0;) {
+            uint64_t cur  = words[w];
+            uint64_t prev = (cur << 1) | (w == 0 ? (cur & 1) : (words[w - 1] >> 63));
+            uint64_t diff = (cur ^ prev) & mask;
+            if (edge == SignalEdge::Posedge) {
+                diff &= cur;
+            } else if (edge == SignalEdge::Negedge) {
+                diff &= ~cur;
+            }
+            mask = ~0ULL;
+
+            if (diff != 0) {
+                return (w << 6) + 63 - std::countl_zero(diff);
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    size_t memoryUsage() const { return words.capacity() * sizeof(uint64_t); }
+
+  private:
+    void setRange(uint64_t from, uint64_t to) {
+        while (from < to) {
+            uint64_t w     = from >> 6;
+            uint64_t shift = from & 63;
+            uint64_t bits  = std::min<uint64_t>(64 - shift, to - from);
+            words[w] |= (bits == 64 ? ~0ULL : ((1ULL << bits) - 1)) << shift;
+            from += bits;
+        }
+    }
+
+    std::vector<uint64_t> words;
+    uint64_t size = 0;
+};
+
+// Picks a dense, a bit-packed or a change-point layout depending on how often the value changes, all of them behind the same `get`.
+template <typename T> class AdaptiveValueVec {
+  public:
+    enum class Layout { Dense, ChangePoint, Bit };
+
+    void init(size_t size, Layout layout) {
+        this->layout = layout;
+        if (layout == Layout::Dense) {
+            dense.init(size);
+        } else if (layout == Layout::Bit) {
+            bit.init(size);
+        } else {
+            changePoint.init(size);
+        }
+    }
+
+    // `indices[i]` is the first index holding `values[i]`, `indices` must be increasing and `indices[0]` must be 0.
+    template <typename V> void build(const std::vector<uint64_t> &indices, const std::vector<V> &values, size_t size, Layout layout) {
+        this->layout = layout;
+        if (layout == Layout::Dense) {
+            dense.build(indices, values, size);
+        } else if (layout == Layout::Bit) {
+            bit.build(indices, values, size);
+        } else {
+            changePoint.build(indices, values, size);
+        }
+    }
+
+    // Approximate bytes of `layout` for `size` indices holding `changeCnt` changes.
+    static uint64_t estimateBytes(Layout layout, uint64_t changeCnt, uint64_t size) {
+        switch (layout) {
+        case Layout::Dense:
+            return size * sizeof(T);
+        case Layout::Bit:
+            return ((size + 63) >> 6) * sizeof(uint64_t);
+        default: {
+            uint64_t blockCnt = (size + VALUE_STORE_BLOCK_MASK) >> VALUE_STORE_BLOCK_SHIFT;
+            return blockCnt * (2 * sizeof(std::vector<T>) + sizeof(uint16_t) + sizeof(T)) + changeCnt * (sizeof(uint16_t) + sizeof(T));
+        }
+        }
+    }
+
+    // Multi-bit values: a change point costs an offset plus a value while a dense entry only costs a value, the change-point layout is worth it when the changes are well below that ratio.
+    // 1-bit values: the smaller of the bit-packed and the change-point layouts.
+    static Layout chooseLayout(uint64_t changeCnt, uint64_t sampleCnt, double compactDensity, uint32_t bitSize = sizeof(T) * 8) {
+        if (sampleCnt == 0) {
+            return bitSize == 1 ? Layout::Bit : Layout::Dense;
+        }
+        if (bitSize == 1) {
+            return estimateBytes(Layout::ChangePoint, changeCnt, sampleCnt) < estimateBytes(Layout::Bit, changeCnt, sampleCnt) ? Layout::ChangePoint : Layout::Bit;
+        }
+        return ((double)changeCnt / (double)sampleCnt) <= compactDensity ? Layout::ChangePoint : Layout::Dense;
+    }
+
+    inline void set(uint64_t idx, T value) {
+        if (layout == Layout::Dense) {
+            dense.set(idx, value);
+        } else if (layout == Layout::Bit) {
+            bit.set(idx, value);
+        } else {
+            changePoint.set(idx, value);
+        }
+    }
+
+    void seal(uint64_t startIdx, uint64_t finishIdx) {
+        if (layout == Layout::ChangePoint) {
+            changePoint.seal(startIdx, finishIdx);
+        }
+    }
+
+    inline T get(uint64_t idx) const {
+        if (layout == Layout::Dense) [[likely]] {
+            return dense.get(idx);
+        } else if (layout == Layout::Bit) {
+            return bit.get(idx);
+        } else {
+            return changePoint.get(idx);
+        }
+    }
+
+    // First index after `idx` at which `edge` happens, UINT64_MAX if there is none.
+    uint64_t nextEdge(uint64_t idx, SignalEdge edge) const {
+        if (layout == Layout::Dense) {
+            return dense.nextEdge(idx, edge);
+        } else if (layout == Layout::Bit) {
+            return bit.nextEdge(idx, edge);
+        } else {
+            return changePoint.nextEdge(idx, edge);
+        }
+    }
+
+    // Last index at or before `idx` at which `edge` happens, UINT64_MAX if there is none.
+    uint64_t prevEdge(uint64_t idx, SignalEdge edge) const {
+        if (layout == Layout::Dense) {
+            return dense.prevEdge(idx, edge);
+        } else if (layout == Layout::Bit) {
+            return bit.prevEdge(idx, edge);
+        } else {
+            return changePoint.prevEdge(idx, edge);
+        }
+    }
+
+    Layout getLayout() const { return layout; }
+    const char *layoutName() const { return layout == Layout::Dense ? "Dense" : (layout == Layout::Bit ? "Bit" : "ChangePoint"); }
+    size_t memoryUsage() const { return layout == Layout::Dense ? dense.memoryUsage() : (layout == Layout::Bit ? bit.memoryUsage() : changePoint.memoryUsage()); }
+
+  private:
+    Layout layout = Layout::Dense;
+    DenseVec<T> dense;
+    BitVec bit;
+    ChangePointVec<T> changePoint;
+};
+
+// Time-major store of a group of signals that are read together: the values of all the members at one time-table index are adjacent (`data[idx * slotCnt + slot]`), so reading the whole group at a step touches one or two cache lines instead of one per member.
+template <typename T> class GroupedValueVec {
+  public:
+    void init(size_t size, uint32_t slotCnt) {
+        data.reset(new T[size * slotCnt]);
+        this->size    = size;
+        this->slotCnt = slotCnt;
+        changes.assign(slotCnt, {});
+    }
+
+    // `indices[i]` is the first index holding `values[i]`, `indices` must be increasing and `indices[0]` must be 0.
+    template <typename V> void buildSlot(uint32_t slot, const std::vector<uint64_t> &indices, const std::vector<V> &values) {
+        auto &slotChanges = changes[slot];
+        slotChanges.clear();
+        for (size_t i = 0; i < indices.size(); i++) {
+            uint64_t end = i + 1 < indices.size() ? indices[i + 1] : size;
+            if (i > 0 && static_cast<T>(values[i]) != static_cast<T>(values[i - 1])) {
+                slotChanges.emplace_back(indices[i]);
+            }
+            for (uint64_t idx = indices[i]; idx < end; idx++) {
+                data[idx * slotCnt + slot] = static_cast<T>(values[i]);
+            }
+        }
+    }
+
+    // Copy a slot from any per-index reader, e.g. the per-signal store the member had before being grouped.
+    template <typename F> void fillSlot(uint32_t slot, F &&valueAt) {
+        auto &slotChanges = changes[slot];
+        slotChanges.clear();
+        for (uint64_t idx = 0; idx < size; idx++) {
+            data[idx * slotCnt + slot] = static_cast<T>(valueAt(idx));
+            if (idx > 0 && get(idx, slot) != get(idx - 1, slot)) {
+                slotChanges.emplace_back(idx);
+            }
+        }
+    }
+
+    inline T get(uint64_t idx, uint32_t slot) const { return data[idx * slotCnt + slot]; }
+
+    // First index after `idx` at which `edge` happens, UINT64_MAX if there is none. Only the recorded change indices of `slot` are visited.
+    uint64_t nextEdge(uint64_t idx, uint32_t slot, SignalEdge edge) const {
+        auto &slotChanges = changes[slot];
+        for (auto it = std::upper_bound(slotChanges.begin(), slotChanges.end(), idx); it != slotChanges.end(); it++) {
+            if (isEdge(get(*it - 1, slot), get(*it, slot), edge)) {
+                return *it;
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    // Last index at or before `idx` at which `edge` happens, UINT64_MAX if there is none.
+    uint64_t prevEdge(uint64_t idx, uint32_t slot, SignalEdge edge) const {
+        auto &slotChanges = changes[slot];
+        for (auto it = std::upper_bound(slotChanges.begin(), slotChanges.end(), idx); it != slotChanges.begin();) {
+            it--;
+            if (isEdge(get(*it - 1, slot), get(*it, slot), edge)) {
+                return *it;
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    static uint64_t estimateBytes(uint32_t slotCnt, uint64_t size) { return size * slotCnt * sizeof(T); }
+
+    uint32_t getSlotCnt() const { return slotCnt; }
+    size_t memoryUsage() const {
+        size_t changeBytes = 0;
+        for (auto &slotChanges : changes) {
+            changeBytes += slotChanges.capacity() * sizeof(uint64_t);
+        }
+        return estimateBytes(slotCnt, size) + changeBytes;
+    }
+
+  private:
+    std::unique_ptr<T[]> data;
+    size_t size      = 0;
+    uint32_t slotCnt = 0;
+    std::vector<std::vector<uint64_t>> changes; // Indices at which each slot differs from the previous index, increasing
+};
+
+// Analytic model of a strictly periodic 1-bit signal, e.g. a free-running clock.
+// The signal holds `initValue` until `firstEdge`, then toggles at `firstEdge + k * period` and at `firstEdge + k * period + firstPhase` (k >= 0) until `edgeCnt` edges have happened. Both the value and the next edge at a given time are computed in O(1) with no per-change storage.
+class PeriodicClock {
+  public:
+    // `times[i]` is the time from which `values[i]` holds, `times[0]` is the start of the wave.
+    // Returns false if the signal is not a strictly periodic toggle with at least `minEdges` edges, a clock whose period changes (e.g. clock gating) is not periodic.
+    bool detect(const std::vector<uint64_t> &times, const std::vector<uint64_t> &values, uint64_t minEdges) {
+        if (times.size() != values.size() || times.size() < 4 || times.size() - 1 < minEdges) {
+            return false;
+        }
+        for (auto value : values) {
+            if (value > 1) {
+                return false;
+            }
+        }
+
+        initValue  = values[0];
+        firstEdge  = times[1];
+        firstPhase = times[2] - times[1];
+        period     = times[3] - times[1];
+        edgeCnt    = times.size() - 1;
+        if (firstPhase == 0 || firstPhase >= period) {
+            return false;
+        }
+
+        for (uint64_t k = 0; k < edgeCnt; k++) {
+            if (times[k + 1] != edgeTime(k) || values[k + 1] != valueAfterEdge(k)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline uint32_t valueAt(uint64_t time) const {
+        if (time < firstEdge) {
+            return initValue;
+        }
+        return valueAfterEdge(std::min(lastEdgeAtOrBefore(time), edgeCnt - 1));
+    }
+
+    // Time of the first `edge` after `time`, UINT64_MAX if there is none.
+    uint64_t nextEdgeTime(uint64_t time, SignalEdge edge) const {
+        uint64_t k = time < firstEdge ? 0 : lastEdgeAtOrBefore(time) + 1;
+        if (edge != SignalEdge::Any && (valueAfterEdge(k) == 1) != (edge == SignalEdge::Posedge)) {
+            k++; // Edges alternate, the next one is of the other kind
+        }
+        return k < edgeCnt ? edgeTime(k) : UINT64_MAX;
+    }
+
+    // Time of the last `edge` at or before `time`, UINT64_MAX if there is none.
+    uint64_t prevEdgeTime(uint64_t time, SignalEdge edge) const {
+        if (time < firstEdge || edgeCnt == 0) {
+            return UINT64_MAX;
+        }
+        uint64_t k = std::min(lastEdgeAtOrBefore(time), edgeCnt - 1);
+        if (edge != SignalEdge::Any && (valueAfterEdge(k) == 1) != (edge == SignalEdge::Posedge)) {
+            if (k == 0) {
+                return UINT64_MAX;
+            }
+            k--;
+        }
+        return edgeTime(k);
+    }
+
+    uint64_t getPeriod() const { return period; }
+    uint64_t getEdgeCnt() const { return edgeCnt; }
+
+  private:
+    inline uint64_t edgeTime(uint64_t k) const { return firstEdge + (k >> 1) * period + (k & 1) * firstPhase; }
+    inline uint32_t valueAfterEdge(uint64_t k) const { return (k & 1) ? initValue : (initValue ^ 1); }
+
+    // Index of the last edge (ignoring `edgeCnt`) at or before `time`, `time` must not be less than `firstEdge`.
+    inline uint64_t lastEdgeAtOrBefore(uint64_t time) const {
+        uint64_t delta = time - firstEdge;
+        return (delta / period) * 2 + ((delta % period) >= firstPhase ? 1 : 0);
+    }
+
+    uint32_t initValue  = 0;
+    uint64_t firstEdge  = 0;
+    uint64_t firstPhase = 0;
+    uint64_t period     = 1;
+    uint64_t edgeCnt    = 0;
+};
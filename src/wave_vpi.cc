@@ -5,74 +5,59 @@ std::shared_ptr<FsdbWaveVpi> fsdbWaveVpi;
 
 std::atomic<uint32_t> jitOptThreadCnt = 0;
 bool enableJIT = true;
-uint32_t jitMaxOptThreads = JIT_DEFAULT_MAX_OPT_THREADS;
-uint64_t jitHotAccessThreshold = JTT_DEFAULT_HOT_ACCESS_THRESHOLD;
+// The knobs below are atomic since they can be adjusted by `jitController` while the optimization threads are running.
+std::atomic<uint32_t> jitMaxOptThreads = JIT_DEFAULT_MAX_OPT_THREADS;
+std::atomic<uint64_t> jitHotAccessThreshold = JTT_DEFAULT_HOT_ACCESS_THRESHOLD;
 uint64_t jitCompileThreshold = JTT_DEFAULT_COMPILE_THRESHOLD;
-uint64_t jitCompileWindowSize = JIT_DEFAULT_RECOMPILE_WINDOW_SIZE;
-uint64_t jitRecompileWindowSize = JIT_DEFAULT_RECOMPILE_WINDOW_SIZE;
+std::atomic<uint64_t> jitCompileWindowSize = JIT_DEFAULT_RECOMPILE_WINDOW_SIZE;
+std::atomic<uint64_t> jitRecompileWindowSize = JIT_DEFAULT_RECOMPILE_WINDOW_SIZE;
+JitController jitController;
+FsdbStreamer fsdbStreamer;
+double jitCompactDensity = JIT_DEFAULT_COMPACT_DENSITY;
 
 // Used by <ffrReadScopeVarTree2>
 typedef struct {
-    int desiredDepth;
-    std::string_view fullName;
-    fsdbVarIdcode retVarIdCode;
+    std::string scopePath;             // Full name of the current scope followed by a '.', e.g. "tb_top.dut."
+    std::vector<size_t> scopePathLens; // Length of `scopePath` before each of the current scopes was entered
+    std::string *nameArena;
+    std::vector<FsdbNameIndexEntry> *entries;
 } FsdbTreeCbContext;
 
-uint32_t currentDepth = 0;
-char currentScope[MAX_SCOPE_DEPTH][256];
-
 static bool_T fsdbTreeCb(fsdbTreeCBType cbType, void *cbClientData, void *cbData) {
+    auto contextData = (FsdbTreeCbContext *)cbClientData;
     switch (cbType) {
         case FSDB_TREE_CBT_SCOPE: {
             fsdbTreeCBDataScope *scopeData = (fsdbTreeCBDataScope *)cbData;
-            if (currentDepth < MAX_SCOPE_DEPTH - 1) {
-                strcpy(currentScope[currentDepth], scopeData->name);
-                currentDepth++;
-            }
+            contextData->scopePathLens.emplace_back(contextData->scopePath.size());
+            contextData->scopePath.append(scopeData->name);
+            contextData->scopePath.push_back('.');
             break;
         }
         case FSDB_TREE_CBT_VAR: {
-            auto contextData = (FsdbTreeCbContext *)cbClientData;
-            if (contextData->desiredDepth != currentDepth) {
-                return FALSE;
-            }
             fsdbTreeCBDataVar *varData = (fsdbTreeCBDataVar *)cbData;
-
-            char fullName[256] = "";
-            for (int i = 0; i < currentDepth; ++i) {
-                strcat(fullName, currentScope[i]);
-                strcat(fullName, ".");
-            }
-
-            std::string varDataName = varData->name;
-            std::size_t start, end;
-            while ((start = varDataName.find('[')) != std::string::npos && (end = varDataName.find(']')) != std::string::npos) {
-                if (end > start) {
-                    varDataName.erase(start, end - start + 1);
-                }
-            }
-            strcat(fullName, varDataName.c_str());
-
-            if (std::string_view(fullName) == contextData->fullName) {
-                // fmt::println("Full Name: {} varDataName: {} varIdx: {} depth: {} desiredDepth: {}", fullName, varDataName, varData->u.idcode, currentDepth, contextData->desiredDepth);
-                contextData->retVarIdCode = varData->u.idcode;
-                fsdbWaveVpi->varIdCodeCache[std::string(contextData->fullName)] = varData->u.idcode;
-                return FALSE; // return FALSE to stop the traverse
-            } else {
-                std::string insertKeyStr = std::string(fullName);
-                std::size_t start, end;
-                while ((start = insertKeyStr.find('[')) != std::string::npos && (end = insertKeyStr.find(']')) != std::string::npos) {
-                    if (end > start) {
-                        insertKeyStr.erase(start, end - start + 1);
-                    }
+            auto &nameArena            = *contextData->nameArena;
+            auto offset                = nameArena.size();
+
+            // Append "<scope path><var name>" into the arena with the ranges(e.g. "[7:0]") of the var name stripped.
+            nameArena.append(contextData->scopePath);
+            bool inRange = false;
+            for (const char *c = varData->name; *c != '\0'; c++) {
+                if (*c == '[') {
+                    inRange = true;
+                } else if (*c == ']') {
+                    inRange = false;
+                } else if (!inRange) {
+                    nameArena.push_back(*c);
                 }
-                // The varIdCodeCache will store the varIdCode of the same scope depth into it even it is not required by the user.
-                fsdbWaveVpi->varIdCodeCache[insertKeyStr] = varData->u.idcode;
             }
+            contextData->entries->emplace_back(FsdbNameIndexEntry{.offset = offset, .length = static_cast<uint32_t>(nameArena.size() - offset), .idcode = varData->u.idcode});
             break;
         }
         case FSDB_TREE_CBT_UPSCOPE: {
-            currentDepth--;
+            if (!contextData->scopePathLens.empty()) {
+                contextData->scopePath.resize(contextData->scopePathLens.back());
+                contextData->scopePathLens.pop_back();
+            }
             break;
         }
         default:
@@ -104,57 +89,29 @@ FsdbWaveVpi::FsdbWaveVpi(ffrObject *fsdbObj, std::string_view waveFileName) : fs
         fsdbObj->ffrReadScopeVarTree();
         maxVarIdcode = fsdbObj->ffrGetMaxVarIdcode();
 
-        fmt::println("[wave_vpi] FsdbWaveVpi start load all signals...");
-        fflush(stdout);
-            
-        uint32_t maxIndexVarCode = TIME_TABLE_MAX_INDEX_VAR_CODE;
-        auto _maxIndexVarCode = std::getenv("MAX_INDEX_VAR_CODE");
-        if(_maxIndexVarCode != nullptr) {
-            maxIndexVarCode = std::stoull(_maxIndexVarCode);
-            sigNum = maxIndexVarCode;
-        }
-
-        fmt::println("[wave_vpi] FsdbWaveVpi TIME_TABLE_MAX_INDEX_VAR_CODE => {}", maxIndexVarCode);
-        fflush(stdout);
-
-        for (int i = FSDB_MIN_VAR_IDCODE; i <= maxIndexVarCode; i++) {
-            // !! DO NOT try to load all signals !!
-            fsdbObj->ffrAddToSignalList(i);
-            sigArr[i - 1] = i;
-        }
-        fsdbObj->ffrLoadSignals();
-        fmt::println("[wave_vpi] FsdbWaveVpi load all signals finish");
-        fflush(stdout);
-
-        if (sigNum > maxVarIdcode) {
-            sigNum = maxVarIdcode - 1;
-        }
-        tbVcTrvsHdl = fsdbObj->ffrCreateTimeBasedVCTrvsHdl(sigNum, sigArr);
-        if (NULL == tbVcTrvsHdl) {
-            PANIC("Failed to create time based vc trvs hdl! please re-execute the program.", sigNum, sigArr, this->waveFileName);
-        }
-
         bool useCachedData = false;
+        std::string timeTableSignals;
+        std::string lastTimeTableSignals;
         std::ifstream lastModifiedTimeFile(LAST_MODIFIED_TIME_FILE);
         auto waveFileSize = std::filesystem::file_size(waveFileName);
         auto lastWriteTime = (uint64_t)std::filesystem::last_write_time(waveFileName).time_since_epoch().count();
 
-        auto updateLastModifiedTimeFile = [&waveFileSize, &lastWriteTime]() {
+        auto updateLastModifiedTimeFile = [&waveFileSize, &lastWriteTime, &timeTableSignals]() {
             std::ofstream _lastModifiedTimeFile(LAST_MODIFIED_TIME_FILE);
             _lastModifiedTimeFile << waveFileSize << std::endl;
             _lastModifiedTimeFile << lastWriteTime << std::endl;
+            _lastModifiedTimeFile << timeTableSignals << std::endl;
             _lastModifiedTimeFile.close();
         };
 
         if(lastModifiedTimeFile.is_open()) {
             std::string waveFileSizeStr;
             std::string lastModifiedTimeStr;
-            std::string isFinish;
 
             try {
                 std::getline(lastModifiedTimeFile, waveFileSizeStr);
                 std::getline(lastModifiedTimeFile, lastModifiedTimeStr);
-                std::getline(lastModifiedTimeFile, isFinish);
+                std::getline(lastModifiedTimeFile, lastTimeTableSignals);
                 lastModifiedTimeFile.close();
                 
                 auto _waveFileSize = std::stoull(waveFileSizeStr);
@@ -162,77 +119,107 @@ FsdbWaveVpi::FsdbWaveVpi(ffrObject *fsdbObj, std::string_view waveFileName) : fs
                 
                 if(_waveFileSize == waveFileSize && _lastModifiedTime == lastWriteTime) {
                     useCachedData = true;
-                } else {
-                    updateLastModifiedTimeFile();
                 }
             } catch(std::invalid_argument &e) {
                 fmt::println("[wave_vpi] FsdbWaveVpi ERROR while reading:{}! => std::invalid_argument", LAST_MODIFIED_TIME_FILE);
-                updateLastModifiedTimeFile();
             }
+        }
+
+        // The full name => idcode index is required by the time table signal selection below.
+        if(!useCachedData || !loadNameIndex()) {
+            std::vector<FsdbNameIndexEntry> entries;
+            buildNameIndex(entries);
+            saveNameIndex(entries);
+        }
+
+        // Select the signals whose value changes make up the time table:
+        //      WAVE_VPI_FSDB_TIME_TABLE_SIGNALS=all                            => all the signals
+        //      WAVE_VPI_FSDB_TIME_TABLE_SIGNALS=tb_top.clock,tb_top.dut.clock  => only the given signals, e.g. the clocks
+        //      (not set)                                                       => the first MAX_INDEX_VAR_CODE(default: TIME_TABLE_MAX_INDEX_VAR_CODE) signals
+        std::vector<fsdbVarIdcode> timeTableVarIdCodes;
+        auto _timeTableSignals = std::getenv("WAVE_VPI_FSDB_TIME_TABLE_SIGNALS");
+        if(_timeTableSignals != nullptr && std::string(_timeTableSignals) == "all") {
+            timeTableSignals = "all";
+            for (fsdbVarIdcode i = FSDB_MIN_VAR_IDCODE; i <= maxVarIdcode; i++) {
+                timeTableVarIdCodes.emplace_back(i);
+            }
+        } else if(_timeTableSignals != nullptr) {
+            timeTableSignals = std::string(_timeTableSignals);
+            std::stringstream ss(timeTableSignals);
+            std::string signalName;
+            while(std::getline(ss, signalName, ',')) {
+                if(!signalName.empty()) {
+                    timeTableVarIdCodes.emplace_back(getVarIdCodeByName(signalName.data()));
+                }
+            }
+            std::sort(timeTableVarIdCodes.begin(), timeTableVarIdCodes.end());
+            timeTableVarIdCodes.erase(std::unique(timeTableVarIdCodes.begin(), timeTableVarIdCodes.end()), timeTableVarIdCodes.end());
         } else {
-            updateLastModifiedTimeFile();
+            uint32_t maxIndexVarCode = TIME_TABLE_MAX_INDEX_VAR_CODE;
+            auto _maxIndexVarCode = std::getenv("MAX_INDEX_VAR_CODE");
+            if(_maxIndexVarCode != nullptr) {
+                maxIndexVarCode = std::stoull(_maxIndexVarCode);
+            }
+            timeTableSignals = fmt::format("first:{}", maxIndexVarCode);
+            for (fsdbVarIdcode i = FSDB_MIN_VAR_IDCODE; i <= std::min<fsdbVarIdcode>(maxIndexVarCode, maxVarIdcode); i++) {
+                timeTableVarIdCodes.emplace_back(i);
+            }
         }
+        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_FSDB_TIME_TABLE_SIGNALS:{} => {} signals", timeTableSignals, timeTableVarIdCodes.size());
+        fflush(stdout);
 
-        fmt::println("[wave_vpi] FsdbWaveVpi useCachedData: {}", useCachedData);
+        // The cached time table is only valid if it was collected from the same signals
+        bool useCachedTimeTable = useCachedData && lastTimeTableSignals == timeTableSignals;
+        fmt::println("[wave_vpi] FsdbWaveVpi useCachedData: {} useCachedTimeTable: {}", useCachedData, useCachedTimeTable);
 
-        if(useCachedData) {
+        if(useCachedTimeTable) {
             std::ifstream timeTableFile(TIME_TABLE_FILE, std::ios::binary);
             if(timeTableFile.is_open()) {
                 std::size_t vecSize;
+                std::vector<uint64_t> chunk;
 
                 timeTableFile.read(reinterpret_cast<char *>(&vecSize), sizeof(vecSize)); // The first elements is vector size
-                xtagU64Vec.resize(vecSize);
-                
-                timeTableFile.read(reinterpret_cast<char *>(xtagU64Vec.data()), vecSize * sizeof(uint64_t));
-                timeTableFile.close();
 
-                xtagVec.resize(vecSize);
-                for(size_t i = 0; i < vecSize; i++) {
-                    xtagVec[i].hltag.H = xtagU64Vec[i] >> 32;
-                    xtagVec[i].hltag.L = xtagU64Vec[i] & 0xFFFFFFFF;
+                // Read in chunks and compress on the fly so that the uncompressed time table is never held in memory.
+                timeTable.clear();
+                for(std::size_t readSize = 0; readSize < vecSize; readSize += chunk.size()) {
+                    chunk.resize(std::min<std::size_t>(vecSize - readSize, TIME_TABLE_FILE_CHUNK_SIZE));
+                    timeTableFile.read(reinterpret_cast<char *>(chunk.data()), chunk.size() * sizeof(uint64_t));
+                    for(auto time : chunk) {
+                        timeTable.push_back(time);
+                    }
                 }
+                timeTable.finish();
+                timeTableFile.close();
 
-                fmt::println("[wave_vpi] FsdbWaveVpi read from timeTableFile => xtagU64Vec size: {}", xtagU64Vec.size());
+                fmt::println("[wave_vpi] FsdbWaveVpi read from timeTableFile => timeTable size: {} memory: {} bytes", timeTable.size(), timeTable.memoryUsage());
             } else {
                 fmt::println("[wave_vpi] FsdbWaveVpi failed to open {}, doing normal parse...", TIME_TABLE_FILE);
                 goto NormalParse;
             }
         } else {
 NormalParse:
-            fmt::println("[wave_vpi] FsdbWaveVpi start collecting xtagU64Set");
-            fflush(stdout);
-
-            int i = 0;
-            fsdbXTag xtag;
-            std::set<uint64_t> xtagU64Set;
-            while (FSDB_RC_SUCCESS == tbVcTrvsHdl->ffrGotoNextVC()) {
-                tbVcTrvsHdl->ffrGetXTag((void *)&xtag);
-                auto u64Xtag = Xtag64ToUInt64(xtag.hltag);
-                if (xtagU64Set.find(u64Xtag) == xtagU64Set.end()) {
-                    xtagU64Set.insert(u64Xtag);
-                    xtagVec.emplace_back(xtag);
-                }
-                i++;
-            }
-            fmt::println("[wave_vpi] FsdbWaveVpi xtagU64Set size: {}, total size: {}", xtagU64Set.size(), i);
-            fflush(stdout);
-
-            // Create xtagU64Vec besed on xtagU64Set
-            xtagU64Vec.assign(xtagU64Set.begin(), xtagU64Set.end());
+            buildTimeTable(timeTableVarIdCodes);
 
             // Save time table into file so that we do not require much time to parse time table.
             std::ofstream timeTableFile(TIME_TABLE_FILE, std::ios::binary);
-            std::size_t vecSize = xtagU64Vec.size();
+            std::size_t vecSize = timeTable.size();
+            std::vector<uint64_t> chunk;
             ASSERT(timeTableFile.is_open(), "Failed to open TIME_TABLE_FILE!", TIME_TABLE_FILE);
             timeTableFile.write(reinterpret_cast<char *>(&vecSize), sizeof(vecSize));
-            timeTableFile.write(reinterpret_cast<char *>(xtagU64Vec.data()), vecSize * sizeof(uint64_t));
+            for(std::size_t writeSize = 0; writeSize < vecSize; writeSize += chunk.size()) {
+                chunk.resize(std::min<std::size_t>(vecSize - writeSize, TIME_TABLE_FILE_CHUNK_SIZE));
+                for(std::size_t i = 0; i < chunk.size(); i++) {
+                    chunk[i] = timeTable.get(writeSize + i);
+                }
+                timeTableFile.write(reinterpret_cast<char *>(chunk.data()), chunk.size() * sizeof(uint64_t));
+            }
             ASSERT(timeTableFile, "Failed to write to file", TIME_TABLE_FILE);
             timeTableFile.close();
-        }
 
-        // Recreate tbVcTrvsHdl to reset the xtag to start point
-        tbVcTrvsHdl->ffrFree();
-        tbVcTrvsHdl = fsdbObj->ffrCreateTimeBasedVCTrvsHdl(sigNum, sigArr);
+            // Written after all the cache files so that an interrupted run never leaves a valid identity next to a stale cache.
+            updateLastModifiedTimeFile();
+        }
 
         auto _enableJIT = std::getenv("WAVE_VPI_ENABLE_JIT");
         if(_enableJIT != nullptr) {
@@ -243,14 +230,16 @@ NormalParse:
         auto _jitMaxOptThreads = std::getenv("WAVE_VPI_JIT_MAX_OPT_THREADS");
         if(_jitMaxOptThreads != nullptr) {
             jitMaxOptThreads = std::stoul(_jitMaxOptThreads);
+            jitController.pinMaxOptThreads = true;
         }
-        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_MAX_OPT_THREADS:{}", jitMaxOptThreads);
+        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_MAX_OPT_THREADS:{}", jitMaxOptThreads.load());
 
         auto _jitHotAccessThreshold = std::getenv("WAVE_VPI_JIT_HOT_ACCESS_THRESHOLD");
         if(_jitHotAccessThreshold != nullptr) {
             jitHotAccessThreshold = std::stoull(_jitHotAccessThreshold);
+            jitController.pinHotAccessThreshold = true;
         }
-        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_HOT_ACCESS_THRESHOLD:{}", jitHotAccessThreshold);
+        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_HOT_ACCESS_THRESHOLD:{}", jitHotAccessThreshold.load());
 
         auto _jitCompileThreshold = std::getenv("WAVE_VPI_JIT_COMPILE_THRESHOLD");
         if(_jitCompileThreshold != nullptr) {
@@ -261,71 +250,508 @@ NormalParse:
         auto _jitCompileWindowSize = std::getenv("WAVE_VPI_JIT_COMPILE_WINDOW_SIZE");
         if(_jitCompileWindowSize != nullptr) {
             jitCompileWindowSize = std::stoull(_jitCompileWindowSize);
+            jitController.pinCompileWindowSize = true;
         }
-        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_COMPILE_WINDOW_SIZE:{}", jitCompileWindowSize);
+        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_COMPILE_WINDOW_SIZE:{}", jitCompileWindowSize.load());
 
         auto _jitRecompileWindowSize = std::getenv("WAVE_VPI_JIT_RECOMPILE_WINDOW_SIZE");
         if(_jitRecompileWindowSize != nullptr) {
+            jitController.pinRecompileWindowSize = true;
             if(std::string(_jitRecompileWindowSize) == "-1") {
-                jitRecompileWindowSize = jitCompileWindowSize;
-                fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_RECOMPILE_WINDOW_SIZE = WAVE_VPI_JIT_COMPILE_WINDOW_SIZE = {}", jitRecompileWindowSize);
+                jitRecompileWindowSize = jitCompileWindowSize.load();
+                fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_RECOMPILE_WINDOW_SIZE = WAVE_VPI_JIT_COMPILE_WINDOW_SIZE = {}", jitRecompileWindowSize.load());
             } else {
                 jitRecompileWindowSize = std::stoull(_jitRecompileWindowSize);
-                fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_RECOMPILE_WINDOW_SIZE:{}", jitRecompileWindowSize);
+                fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_RECOMPILE_WINDOW_SIZE:{}", jitRecompileWindowSize.load());
             }
         }
 
-        ASSERT(jitRecompileWindowSize <= jitCompileWindowSize, "`jitRecompileWindowSize` should less than or equal to `jitCompileWindowSize`", jitRecompileWindowSize, jitCompileWindowSize);
+        ASSERT(jitRecompileWindowSize <= jitCompileWindowSize, "`jitRecompileWindowSize` should less than or equal to `jitCompileWindowSize`", jitRecompileWindowSize.load(), jitCompileWindowSize.load());
+
+        auto _jitAdaptive = std::getenv("WAVE_VPI_JIT_ADAPTIVE");
+        if(_jitAdaptive != nullptr) {
+            jitController.enable = std::string(_jitAdaptive) == "1";
+        }
+        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_ADAPTIVE:{}", jitController.enable);
+
+        auto _jitAdaptInterval = std::getenv("WAVE_VPI_JIT_ADAPT_INTERVAL");
+        if(_jitAdaptInterval != nullptr) {
+            jitController.adaptInterval = std::stoull(_jitAdaptInterval);
+        }
+        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_ADAPT_INTERVAL:{}", jitController.adaptInterval);
+
+        auto _enableStreaming = std::getenv("WAVE_VPI_FSDB_STREAMING");
+        if(_enableStreaming != nullptr) {
+            fsdbStreamer.enable = std::string(_enableStreaming) == "1";
+        }
+        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_FSDB_STREAMING:{}", fsdbStreamer.enable);
+
+        auto _jitCompactDensity = std::getenv("WAVE_VPI_JIT_COMPACT_DENSITY");
+        if(_jitCompactDensity != nullptr) {
+            jitCompactDensity = std::stod(_jitCompactDensity);
+        }
+        fmt::println("[wave_vpi] FsdbWaveVpi WAVE_VPI_JIT_COMPACT_DENSITY:{}", jitCompactDensity);
     }
 }
 
-fsdbVarIdcode FsdbWaveVpi::getVarIdCodeByName(char *name) {
-    auto it = varIdCodeCache.find(std::string(name));
-    if (it != varIdCodeCache.end()) {
-        // fmt::println("found in varIdCodeCache! {}", name);
-        // fflush(stdout);
-        fsdbVarIdcode existingValue = it->second;
-        return existingValue;
+// Collect the time table from all the value changes of `varIdCodes`.
+// The idcodes are partitioned into contiguous ranges and each range is collected by its own thread with its own non-shared ffrObject. Every thread keeps a sorted and deduplicated vector of times, and the vectors are merged pairwise at the end.
+void FsdbWaveVpi::buildTimeTable(const std::vector<fsdbVarIdcode> &varIdCodes) {
+    uint32_t threadNum = std::clamp<uint32_t>(std::thread::hardware_concurrency(), 1, TIME_TABLE_DEFAULT_MAX_THREADS);
+    auto _threadNum = std::getenv("WAVE_VPI_FSDB_TIME_TABLE_THREADS");
+    if(_threadNum != nullptr) {
+        threadNum = std::stoul(_threadNum);
+    }
+    threadNum = std::max<uint32_t>(1, std::min<size_t>(threadNum, varIdCodes.size()));
+    fmt::println("[wave_vpi] FsdbWaveVpi buildTimeTable start, signals:{} WAVE_VPI_FSDB_TIME_TABLE_THREADS:{}", varIdCodes.size(), threadNum);
+    fflush(stdout);
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::vector<std::vector<uint64_t>> threadTimes(threadNum);
+    std::vector<uint64_t> threadVCCnt(threadNum, 0);
+
+    auto sortAndUnique = [](std::vector<uint64_t> &times) {
+        std::sort(times.begin(), times.end());
+        times.erase(std::unique(times.begin(), times.end()), times.end());
+    };
+
+    auto collect = [&](uint32_t threadIdx, ffrObject *obj) {
+        size_t begin = varIdCodes.size() * threadIdx / threadNum;
+        size_t end = varIdCodes.size() * (threadIdx + 1) / threadNum;
+        auto &times = threadTimes[threadIdx];
+        size_t compactSize = TIME_TABLE_COMPACT_SIZE;
+
+        for(size_t i = begin; i < end; i++) {
+            obj->ffrAddToSignalList(varIdCodes[i]);
+        }
+        obj->ffrLoadSignals();
+
+        fsdbXTag xtag;
+        for(size_t i = begin; i < end; i++) {
+            auto hdl = obj->ffrCreateVCTrvsHdl(varIdCodes[i]);
+            if(hdl == nullptr) {
+                continue;
+            }
+
+            if(FSDB_RC_SUCCESS == hdl->ffrGotoTheFirstVC()) {
+                do {
+                    hdl->ffrGetXTag((void *)&xtag);
+                    times.emplace_back(Xtag64ToUInt64(xtag.hltag));
+                    threadVCCnt[threadIdx]++;
+                } while(FSDB_RC_SUCCESS == hdl->ffrGotoNextVC());
+            }
+            hdl->ffrFree();
+
+            // Keep the memory bounded by the number of unique times instead of the number of value changes.
+            if(times.size() >= compactSize) {
+                sortAndUnique(times);
+                compactSize = std::max<size_t>(compactSize, times.size() * 2);
+            }
+        }
+        sortAndUnique(times);
+        obj->ffrUnloadSignals();
+    };
+
+    if(threadNum == 1) {
+        collect(0, fsdbObj);
+    } else {
+        std::vector<std::thread> threads;
+        for(uint32_t t = 0; t < threadNum; t++) {
+            threads.emplace_back([&, t]() {
+                ffrObject *obj = ffrObject::ffrOpenNonSharedObj(const_cast<char *>(waveFileName.c_str()));
+                ASSERT(obj != nullptr, "Failed to open fsdb file for time table thread", waveFileName, t);
+                obj->ffrReadScopeVarTree();
+                collect(t, obj);
+                obj->ffrClose();
+            });
+        }
+        for(auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    while(threadTimes.size() > 1) {
+        std::vector<std::vector<uint64_t>> mergedTimes;
+        for(size_t i = 0; i + 1 < threadTimes.size(); i += 2) {
+            std::vector<uint64_t> merged;
+            merged.reserve(threadTimes[i].size() + threadTimes[i + 1].size());
+            std::set_union(threadTimes[i].begin(), threadTimes[i].end(), threadTimes[i + 1].begin(), threadTimes[i + 1].end(), std::back_inserter(merged));
+            std::vector<uint64_t>().swap(threadTimes[i]);
+            std::vector<uint64_t>().swap(threadTimes[i + 1]);
+            mergedTimes.emplace_back(std::move(merged));
+        }
+        if(threadTimes.size() % 2 != 0) {
+            mergedTimes.emplace_back(std::move(threadTimes.back()));
+        }
+        threadTimes = std::move(mergedTimes);
     }
+    timeTable.build(threadTimes[0]);
+    uint64_t uncompressedSize = threadTimes[0].size() * sizeof(uint64_t);
+    std::vector<uint64_t>().swap(threadTimes[0]);
 
-    currentDepth = 0;
-    for (int i = 0; i < MAX_SCOPE_DEPTH; i++) {
-        std::memset(currentScope[i], 0, sizeof(currentScope[i]));
+    uint64_t vcCnt = 0;
+    for(auto cnt : threadVCCnt) {
+        vcCnt += cnt;
     }
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double elapsedSec = std::chrono::duration<double>(endTime - startTime).count();
+    fmt::println("[wave_vpi] FsdbWaveVpi buildTimeTable finish, value changes:{} time table size:{} threads:{} time:{:.3f} s throughput:{:.2f} M value changes/s", vcCnt, timeTable.size(), threadNum, elapsedSec, elapsedSec > 0 ? (double)vcCnt / elapsedSec / 1e6 : 0.0);
+    fmt::println("[wave_vpi] FsdbWaveVpi time table memory: {} bytes (uncompressed: {} bytes)", timeTable.memoryUsage(), uncompressedSize);
+    fflush(stdout);
+}
+
+fsdbVarIdcode FsdbWaveVpi::getVarIdCodeByName(char *name) {
+    auto it = nameIndex.find(std::string_view(name));
+    ASSERT(it != nameIndex.end(), "Failed to find varIdCode", name);
+    return it->second;
+}
+
+// Walk the whole scope tree once and index the full name of every var.
+void FsdbWaveVpi::buildNameIndex(std::vector<FsdbNameIndexEntry> &entries) {
+    auto startTime = std::chrono::high_resolution_clock::now();
 
-    std::string fullName      = std::string(name);
-    FsdbTreeCbContext contextData = {.desiredDepth = static_cast<int>(std::count(fullName.begin(), fullName.end(), '.')), .fullName = fullName, .retVarIdCode = 0};
+    nameArena.clear();
+    entries.clear();
+    FsdbTreeCbContext contextData = {.scopePath = "", .scopePathLens = {}, .nameArena = &nameArena, .entries = &entries};
     fsdbObj->ffrReadScopeVarTree2(fsdbTreeCb, (void *)&contextData);
+    nameArena.shrink_to_fit();
 
-    ASSERT(contextData.retVarIdCode != 0, "Failed to find varIdCode", name);
+    indexNames(entries);
 
-    return contextData.retVarIdCode;
+    auto endTime = std::chrono::high_resolution_clock::now();
+    fmt::println("[wave_vpi] FsdbWaveVpi buildNameIndex finish, vars:{} unique names:{} arena size:{} bytes time:{} ms", entries.size(), nameIndex.size(), nameArena.size(), std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+    fflush(stdout);
 }
 
-uint32_t FsdbWaveVpi::findNearestTimeIndex(uint64_t time) {
-    auto it = std::lower_bound(xtagU64Vec.begin(), xtagU64Vec.end(), time);
+// Build `nameIndex` on top of `nameArena`. The first var wins if several vars have the same name after their ranges are stripped, which is the var found first by the scope tree traversal.
+void FsdbWaveVpi::indexNames(const std::vector<FsdbNameIndexEntry> &entries) {
+    nameIndex.clear();
+    nameIndex.reserve(entries.size());
+    for (auto &entry : entries) {
+        nameIndex.try_emplace(std::string_view(nameArena.data() + entry.offset, entry.length), entry.idcode);
+    }
+}
 
-    if (it == xtagU64Vec.end()) {
-        return xtagU64Vec.size() - 1;
-    } else if (it == xtagU64Vec.begin()) {
-        return 0;
-    } else {
-        uint32_t index = it - xtagU64Vec.begin();
-        if (xtagU64Vec[index] == time) {
-            return index;
-        } else {
-            uint32_t before = index - 1;
-            if (xtagU64Vec[before] < time) {
-                return before;
-            } else {
-                return index;
+// NAME_INDEX_FILE layout: [size_t arenaSize][arena bytes][size_t entryCnt][FsdbNameIndexEntry * entryCnt]
+bool FsdbWaveVpi::loadNameIndex() {
+    std::ifstream nameIndexFile(NAME_INDEX_FILE, std::ios::binary);
+    if (!nameIndexFile.is_open()) {
+        return false;
+    }
+
+    std::size_t arenaSize = 0;
+    std::size_t entryCnt  = 0;
+    std::vector<FsdbNameIndexEntry> entries;
+
+    nameIndexFile.read(reinterpret_cast<char *>(&arenaSize), sizeof(arenaSize));
+    nameArena.resize(arenaSize);
+    nameIndexFile.read(nameArena.data(), arenaSize);
+    nameIndexFile.read(reinterpret_cast<char *>(&entryCnt), sizeof(entryCnt));
+    entries.resize(entryCnt);
+    nameIndexFile.read(reinterpret_cast<char *>(entries.data()), entryCnt * sizeof(FsdbNameIndexEntry));
+    if (!nameIndexFile) {
+        fmt::println("[wave_vpi] FsdbWaveVpi failed to read {}, rebuild the name index...", NAME_INDEX_FILE);
+        nameArena.clear();
+        return false;
+    }
+
+    for (auto &entry : entries) {
+        if (entry.offset + entry.length > nameArena.size()) {
+            fmt::println("[wave_vpi] FsdbWaveVpi {} is corrupted, rebuild the name index...", NAME_INDEX_FILE);
+            nameArena.clear();
+            return false;
+        }
+    }
+
+    indexNames(entries);
+    fmt::println("[wave_vpi] FsdbWaveVpi read from {} => vars:{} unique names:{}", NAME_INDEX_FILE, entries.size(), nameIndex.size());
+    return true;
+}
+
+void FsdbWaveVpi::saveNameIndex(const std::vector<FsdbNameIndexEntry> &entries) {
+    std::ofstream nameIndexFile(NAME_INDEX_FILE, std::ios::binary);
+    ASSERT(nameIndexFile.is_open(), "Failed to open NAME_INDEX_FILE!", NAME_INDEX_FILE);
+
+    std::size_t arenaSize = nameArena.size();
+    std::size_t entryCnt  = entries.size();
+    nameIndexFile.write(reinterpret_cast<char *>(&arenaSize), sizeof(arenaSize));
+    nameIndexFile.write(nameArena.data(), arenaSize);
+    nameIndexFile.write(reinterpret_cast<char *>(&entryCnt), sizeof(entryCnt));
+    nameIndexFile.write(reinterpret_cast<const char *>(entries.data()), entryCnt * sizeof(FsdbNameIndexEntry));
+    ASSERT(nameIndexFile, "Failed to write to file", NAME_INDEX_FILE);
+    nameIndexFile.close();
+}
+
+inline static size_t fsdbBytesPerBitToSize(fsdbBytesPerBit bpb) {
+    switch (bpb) {
+    case FSDB_BYTES_PER_BIT_1B:
+        return 1;
+    case FSDB_BYTES_PER_BIT_2B:
+        return 2;
+    case FSDB_BYTES_PER_BIT_4B:
+        return 4;
+    case FSDB_BYTES_PER_BIT_8B:
+        return 8;
+    default:
+        PANIC("Unknown fsdbBytesPerBit", bpb);
+    }
+}
+
+void FsdbStreamer::addSignal(FsdbSignalHandlePtr fsdbSigHdl) {
+    if(fsdbSigHdl->periodic || fsdbSigHdl->stored || fsdbSigHdl->group != nullptr || fsdbSigHdl->streamed || std::find(pendingSigHdls.begin(), pendingSigHdls.end(), fsdbSigHdl) != pendingSigHdls.end()) {
+        return;
+    }
+    pendingSigHdls.emplace_back(fsdbSigHdl);
+}
+
+// Newly added signals are seeded from their own `ffrVCTrvsHdl` and the merged traverse handle is recreated over all the streamed signals, positioned at the current cursor time.
+void FsdbStreamer::rebuild(uint64_t index) {
+    auto fsdbObj = fsdbWaveVpi->fsdbObj;
+    auto time = UInt64ToXtag(timeTable[index]);
+    time.hltag.L = time.hltag.L + 1; // Keep the same time offset as `vpi_get_value`
+
+    for(auto fsdbSigHdl : pendingSigHdls) {
+        auto vcTrvsHdl = fsdbSigHdl->vcTrvsHdl;
+        byte_T *retVC;
+        if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGotoXTag(&time) || FSDB_RC_SUCCESS != vcTrvsHdl->ffrGetVC(&retVC)) [[unlikely]] {
+            PANIC("Failed to seed streamed signal", fsdbSigHdl->name, index);
+        }
+        fsdbSigHdl->streamBpb = vcTrvsHdl->ffrGetBytesPerBit();
+        fsdbSigHdl->streamVC.assign(retVC, retVC + fsdbSigHdl->bitSize * fsdbBytesPerBitToSize(fsdbSigHdl->streamBpb));
+
+        auto &sigHdls = sigHdlMap[fsdbSigHdl->varIdCode];
+        if(sigHdls.empty()) {
+            varIdCodes.emplace_back(fsdbSigHdl->varIdCode);
+            fsdbObj->ffrAddToSignalList(fsdbSigHdl->varIdCode);
+        }
+        sigHdls.emplace_back(fsdbSigHdl);
+    }
+    pendingSigHdls.clear();
+    fsdbObj->ffrLoadSignals();
+
+    if(tbVcTrvsHdl != nullptr) {
+        tbVcTrvsHdl->ffrFree();
+    }
+    tbVcTrvsHdl = fsdbObj->ffrCreateTimeBasedVCTrvsHdl(varIdCodes.size(), varIdCodes.data());
+    if(tbVcTrvsHdl == nullptr) {
+        PANIC("Failed to create time based vc trvs hdl for streaming!", varIdCodes.size());
+    }
+
+    // All the value changes at or before the current time are already covered by the seeded values, so the traverse handle can start from the current time.
+    // If that is not possible, start from the very beginning and replay the value changes up to the current time.
+    finished = false;
+    hasPendingVC = false;
+    if(FSDB_RC_SUCCESS != tbVcTrvsHdl->ffrGotoXTag(&time)) {
+        tbVcTrvsHdl->ffrFree();
+        tbVcTrvsHdl = fsdbObj->ffrCreateTimeBasedVCTrvsHdl(varIdCodes.size(), varIdCodes.data());
+        ASSERT(tbVcTrvsHdl != nullptr);
+        catchUp(index);
+    }
+
+    // Seeding moves the `vcTrvsHdl` of each signal, mark them as streamed only after all of them are done.
+    for(auto &[varIdCode, sigHdls] : sigHdlMap) {
+        for(auto fsdbSigHdl : sigHdls) {
+            fsdbSigHdl->streamed = true;
+        }
+    }
+    rebuildCnt++;
+}
+
+void FsdbStreamer::applyVC() {
+    fsdbVarIdcode varIdCode;
+    byte_T *retVC;
+    tbVcTrvsHdl->ffrGetVarIdcode(&varIdCode);
+    tbVcTrvsHdl->ffrGetVC(&retVC);
+
+    auto it = sigHdlMap.find(varIdCode);
+    if(it == sigHdlMap.end()) [[unlikely]] {
+        return;
+    }
+    for(auto fsdbSigHdl : it->second) {
+        std::memcpy(fsdbSigHdl->streamVC.data(), retVC, fsdbSigHdl->streamVC.size());
+    }
+    vcCnt++;
+}
+
+void FsdbStreamer::advance(uint64_t index) {
+    if(tbVcTrvsHdl != nullptr && !finished) [[likely]] {
+        catchUp(index);
+    }
+
+    if(!pendingSigHdls.empty()) [[unlikely]] {
+        rebuild(index);
+    }
+}
+
+void FsdbStreamer::catchUp(uint64_t index) {
+    uint64_t targetTime = timeTable[index] + 1;
+    while(true) {
+        if(!hasPendingVC) {
+            if(FSDB_RC_SUCCESS != tbVcTrvsHdl->ffrGotoNextVC()) {
+                finished = true;
+                break;
             }
+            fsdbXTag xtag;
+            tbVcTrvsHdl->ffrGetXTag((void *)&xtag);
+            pendingVCTime = Xtag64ToUInt64(xtag.hltag);
+            hasPendingVC = true;
+        }
+
+        if(pendingVCTime > targetTime) {
+            break;
+        }
+        applyVC();
+        hasPendingVC = false;
+    }
+}
+
+// Jump to `index` without applying the value changes in between, e.g. after `wave_vpi_seek`: the streamed signals are seeded again at `index` and the traverse handle continues from there.
+void FsdbStreamer::seek(uint64_t index) {
+    if(tbVcTrvsHdl == nullptr) {
+        return;
+    }
+
+    auto time = UInt64ToXtag(timeTable[index]);
+    time.hltag.L = time.hltag.L + 1; // Keep the same time offset as `vpi_get_value`
+    hasPendingVC = false;
+    finished = false;
+    if(FSDB_RC_SUCCESS != tbVcTrvsHdl->ffrGotoXTag(&time)) {
+        // Same fallback as `rebuild()`, replay from the very beginning
+        tbVcTrvsHdl->ffrFree();
+        tbVcTrvsHdl = fsdbWaveVpi->fsdbObj->ffrCreateTimeBasedVCTrvsHdl(varIdCodes.size(), varIdCodes.data());
+        ASSERT(tbVcTrvsHdl != nullptr);
+        catchUp(index);
+        return;
+    }
+
+    for(auto &[varIdCode, sigHdls] : sigHdlMap) {
+        auto vcTrvsHdl = sigHdls.front()->vcTrvsHdl;
+        byte_T *retVC;
+        if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGotoXTag(&time) || FSDB_RC_SUCCESS != vcTrvsHdl->ffrGetVC(&retVC)) [[unlikely]] {
+            PANIC("Failed to seed streamed signal", sigHdls.front()->name, index);
+        }
+        for(auto fsdbSigHdl : sigHdls) {
+            std::memcpy(fsdbSigHdl->streamVC.data(), retVC, fsdbSigHdl->streamVC.size());
+        }
+    }
+}
+
+void FsdbStreamer::report() {
+    fmt::println("[wave_vpi] FsdbStreamer streamed signals:{} value changes:{} rebuild times:{}", varIdCodes.size(), vcCnt, rebuildCnt);
+}
+
+void JitController::update(uint64_t cursorIndex) {
+    auto now = std::chrono::steady_clock::now();
+    double elapsedSec = std::chrono::duration<double>(now - lastTime).count();
+    uint64_t reads = readCnt - lastReadCnt;
+    uint64_t stalls = stallCnt - lastStallCnt;
+    double stallRate = reads == 0 ? 0.0 : (double)stalls / (double)reads;
+    double cursorSpeed = elapsedSec > 0 ? (double)(cursorIndex - lastIndex) / elapsedSec : 0.0; // indices per second
+    uint64_t _refillNs = refillNs.load(std::memory_order_relaxed);
+    double refillSpeed = _refillNs == 0 ? 0.0 : (double)refillIndexCnt.load(std::memory_order_relaxed) * 1e9 / (double)_refillNs; // indices per second of one optimization thread
+
+    auto oldMaxOptThreads = jitMaxOptThreads.load();
+    auto oldHotAccessThreshold = jitHotAccessThreshold.load();
+    auto oldCompileWindowSize = jitCompileWindowSize.load();
+    auto oldRecompileWindowSize = jitRecompileWindowSize.load();
+
+    // Do not run more optimization threads than the cores that are not busy. The load average counts our own optimization threads as well, they are not taken as the load of others.
+    if(!pinMaxOptThreads) {
+        uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+        double loadAvg = 0;
+        if(getloadavg(&loadAvg, 1) != 1) {
+            loadAvg = 0;
+        }
+        loadAvg = std::max(loadAvg - (double)jitOptThreadCnt.load(), 0.0);
+        int64_t idleCores = (int64_t)cores - (int64_t)std::ceil(loadAvg);
+        jitMaxOptThreads = (uint32_t)std::clamp<int64_t>(idleCores, 1, cores);
+    }
+
+    // The reader is waiting for the optimization threads, make the compile window larger so that each refill covers more indices.
+    if(!pinCompileWindowSize && stallRate > JIT_ADAPT_STALL_RATE) {
+        jitCompileWindowSize = std::min<uint64_t>(oldCompileWindowSize * 2, std::max<uint64_t>(timeTable.size(), VALUE_STORE_BLOCK_SIZE));
+    }
+
+    // The refill of the next window must finish before the cursor reaches the end of the current one.
+    // All the optimization threads share one FsdbReader lock, so a refill may have to wait for the refills of every other optimized signal.
+    if(!pinRecompileWindowSize && refillSpeed > 0 && cursorSpeed > 0) {
+        double activeThreads = std::max<double>(jitOptThreadCnt.load(), 1);
+        double lead = 2.0 * (double)jitCompileWindowSize.load() * cursorSpeed * activeThreads / refillSpeed;
+        jitRecompileWindowSize = std::clamp<uint64_t>((uint64_t)lead, VALUE_STORE_BLOCK_SIZE, jitCompileWindowSize.load());
+    } else if(jitRecompileWindowSize > jitCompileWindowSize) {
+        jitRecompileWindowSize = jitCompileWindowSize.load();
+    }
+
+    // Optimize more signals while the JIT keeps up and there are free optimization threads, and be more selective when it falls behind.
+    if(!pinHotAccessThreshold) {
+        if(stallRate > JIT_ADAPT_STALL_RATE && jitOptThreadCnt.load() >= jitMaxOptThreads.load()) {
+            jitHotAccessThreshold = oldHotAccessThreshold * 2;
+        } else if(reads >= JIT_ADAPT_MIN_READS && stallRate == 0.0 && jitOptThreadCnt.load() < jitMaxOptThreads.load()) {
+            jitHotAccessThreshold = std::max<uint64_t>(oldHotAccessThreshold / 2, std::min(minHotAccessThreshold, oldHotAccessThreshold));
         }
     }
+
+    if(oldMaxOptThreads != jitMaxOptThreads || oldHotAccessThreshold != jitHotAccessThreshold || oldCompileWindowSize != jitCompileWindowSize || oldRecompileWindowSize != jitRecompileWindowSize) {
+        adjustCnt++;
+        fmt::println("[wave_vpi] JitController cursor.index:{} stallRate:{:.4f} cursorSpeed:{:.0f}/s refillSpeed:{:.0f}/s => MAX_OPT_THREADS:{} HOT_ACCESS_THRESHOLD:{} COMPILE_WINDOW_SIZE:{} RECOMPILE_WINDOW_SIZE:{}", cursorIndex, stallRate, cursorSpeed, refillSpeed, jitMaxOptThreads.load(), jitHotAccessThreshold.load(), jitCompileWindowSize.load(), jitRecompileWindowSize.load());
+    }
+
+    lastTime = now;
+    lastIndex = cursorIndex;
+    lastReadCnt = readCnt;
+    lastStallCnt = stallCnt;
+    nextUpdateIndex = cursorIndex + adaptInterval;
+}
+
+void JitController::report() {
+    fmt::println("[wave_vpi] JitController adjustCnt:{} readCnt:{} stallCnt:{}, pin the current values with:", adjustCnt, readCnt, stallCnt);
+    fmt::println("\tWAVE_VPI_JIT_MAX_OPT_THREADS={} WAVE_VPI_JIT_HOT_ACCESS_THRESHOLD={} WAVE_VPI_JIT_COMPILE_WINDOW_SIZE={} WAVE_VPI_JIT_RECOMPILE_WINDOW_SIZE={}", jitMaxOptThreads.load(), jitHotAccessThreshold.load(), jitCompileWindowSize.load(), jitRecompileWindowSize.load());
 }
 #endif
 
 WaveCursor cursor{0, 0, 0, 0};
+TimeTable timeTable;
+bool enableAnalyticClock = true;
+bool enableValueStore = true;
+double valueStoreCompactDensity = VALUE_STORE_DEFAULT_COMPACT_DENSITY;
+ValueStoreBudget valueStoreBudget;
+uint64_t valueStoreCnt = 0;
+std::vector<std::unique_ptr<GroupedValueVec<uint32_t>>> valueGroups;
+std::vector<SignalHandlePtr> valueSlotHdls; // Handles with a value slot, see `wave_vpi_register_value_slot`
+UNORDERED_MAP<vpiHandle, std::unique_ptr<BundleHandle>> bundleMap; // See `wave_vpi_bundle_create`
+bool cursorShifted = false; // True while a signal is read away from the cursor, see `getValueAtIndex()`
+bool cursorSeeked = false; // True once `wave_vpi_seek` moved the cursor during a step, the main loop then runs the next step at the new index instead of moving on
+bool enableValueGroupAuto = false;
+bool valueGroupProbing = false; // True while the main loop records which signals are read together, see `buildAutoValueGroups()`
+uint64_t valueGroupProbeSteps = VALUE_GROUP_DEFAULT_PROBE_STEPS;
+uint64_t valueGroupProbeStep = 0;
+std::vector<uint64_t> stepIndices; // Indices visited by the main loop besides index 0, empty means every index. See `buildStepTimeline()`
+uint64_t replayStartIdx = 0; // Replay window of the main loop, see `wave_vpi_set_window`
+uint64_t replayEndIdx = UINT64_MAX;
+bool replayStarted = false;
+uint64_t shardWarmup = 0; // Indices replayed by a shard before its start, see `runShards()`
+WaveShardInfo shardInfo{.index = -1, .count = 1, .warmupIdx = 0, .startIdx = 0, .endIdx = UINT64_MAX};
+int shardFd = -1; // Write end of the pipe to the parent in a worker
+WaveShardMerge shardMerge = nullptr;
+void *shardMergeContext = nullptr;
+
+#ifndef USE_FSDB
+// Time table accessors for the wellen backend(src/lib.rs), which hands over its time table at init time instead of keeping its own copy.
+extern "C" void wave_vpi_time_table_init(const uint64_t *times, size_t size) {
+    timeTable.clear();
+    for (size_t i = 0; i < size; i++) {
+        timeTable.push_back(times[i]);
+    }
+    timeTable.finish();
+    fmt::println("[wave_vpi] time table size: {} memory: {} bytes (uncompressed: {} bytes)", timeTable.size(), timeTable.memoryUsage(), size * sizeof(uint64_t));
+}
+
+extern "C" uint64_t wave_vpi_time_table_get(uint64_t index) { return timeTable[index]; }
+
+extern "C" uint64_t wave_vpi_time_table_find_index(uint64_t time) { return timeTable.findIndex(time, cursor.index); }
+
+extern "C" uint64_t wave_vpi_time_table_size() { return timeTable.size(); }
+#endif
 
 std::unique_ptr<s_cb_data> startOfSimulationCb = NULL;
 std::unique_ptr<s_cb_data> endOfSimulationCb = NULL;
@@ -344,83 +770,332 @@ std::vector<vpiHandleRaw> willRemoveValueCb;
 // The vpiHandleAllocator is a counter that counts the number of vpiHandles allocated which make it easy to provide unique vpiHandle values.
 vpiHandleRaw vpiHandleAllcator = 0;
 
+// Signal handles are created once per name and shared by all the callers of `vpi_handle_by_name`.
+UNORDERED_MAP<std::string, vpiHandle> handleCache;
+
+std::string waveFilePath;
+bool enableProfile = true;
+#ifdef USE_FSDB
+std::vector<FsdbSignalHandlePtr> profileHotHdls; // See `startProfileJit()`
+#endif
+
 // UNORDERED_MAP<vpiHandle, std::string> hdlToNameMap; // For debug purpose
 
 extern "C" void vlog_startup_routines_bootstrap();
 
+// Index of a bound of the replay window. A start time is rounded up to the first index at or after it, an end time down to the last index at or before it.
+static uint64_t windowBoundIndex(uint32_t unit, uint64_t bound, bool isStart) {
+    ASSERT(unit == waveWindowIndex || unit == waveWindowTime, "Unknown window unit", unit);
+    if(unit == waveWindowIndex || bound == UINT64_MAX) {
+        return std::min(bound, cursor.maxIndex);
+    }
+    if(!isStart) {
+        return timeTable.findIndex(bound);
+    }
+    if(bound == 0) {
+        return 0;
+    }
+    auto index = timeTable.findIndex(bound - 1);
+    if(timeTable[index] < bound && index < cursor.maxIndex) {
+        index++;
+    }
+    return index;
+}
+
+// Replay only [start, end] instead of the whole wave, with both bounds given by index or by time(`unit` is `waveWindowIndex` or `waveWindowTime`, see `windowBoundIndex()`). An `end` of UINT64_MAX runs to the last index.
+// The cursor goes to the start at once, so the startup routines and startOfSimulationCb already see it, and the main loop stops at the end just like at the last index, then calls `endOfSimulation()`. It can only be called before the main loop starts.
+extern "C" void wave_vpi_set_window(uint32_t unit, uint64_t start, uint64_t end) {
+    ASSERT(!replayStarted, "The replay window must be set before the main loop starts");
+    replayStartIdx = windowBoundIndex(unit, start, true);
+    replayEndIdx = windowBoundIndex(unit, end, false);
+    ASSERT(replayStartIdx <= replayEndIdx, "Empty replay window", unit, start, end);
+
+    cursor.updateIndex(replayStartIdx);
+    fmt::println("[wave_vpi] replay window: index [{}, {}] time [{}, {}]", replayStartIdx, replayEndIdx, timeTable[replayStartIdx], timeTable[replayEndIdx]);
+}
+
 void wave_vpi_init(const char *filename) {
+    waveFilePath = std::string(filename);
+
 #ifdef USE_FSDB
     fsdbWaveVpi = std::make_shared<FsdbWaveVpi>(ffrObject::ffrOpenNonSharedObj((char *)filename), std::string(filename));
-    
-    cursor.maxIndex = fsdbWaveVpi->xtagU64Vec.size() - 1;
-    cursor.maxTime  = fsdbWaveVpi->xtagU64Vec.at(fsdbWaveVpi->xtagU64Vec.size() - 1);
 #else
-    wellen_wave_init(filename);
-
-    cursor.maxIndex = wellen_get_max_index();
-    cursor.maxTime = wellen_get_time_from_index(cursor.maxIndex);
+    wellen_wave_init(filename); // Fills `timeTable` through `wave_vpi_time_table_init`
 #endif
-}
+    ASSERT(!timeTable.empty(), "Empty time table", filename);
 
-void endOfSimulation() {
-    static bool isEndOfSimulation = false;
-    
-    if(endOfSimulationCb && !isEndOfSimulation) {
-        isEndOfSimulation = true;
-#ifndef USE_FSDB
-        wellen_vpi_finalize();
-#endif
-        endOfSimulationCb->cb_rtn(endOfSimulationCb.get());
+    cursor.maxIndex = timeTable.size() - 1;
+    cursor.maxTime  = timeTable.back();
+
+    auto _enableAnalyticClock = std::getenv("WAVE_VPI_ANALYTIC_CLOCK");
+    if(_enableAnalyticClock != nullptr) {
+        enableAnalyticClock = std::string(_enableAnalyticClock) == "1";
     }
-}
+    fmt::println("[wave_vpi] WAVE_VPI_ANALYTIC_CLOCK:{}", enableAnalyticClock);
 
-void sigint_handler(int unused) {
-    VL_WARN(R"(
----------------------------------------------------------------------
-----   wave_vpi_main get <SIGINT>, the program will terminate...      ----
----------------------------------------------------------------------
-)");
+    auto _enableValueStore = std::getenv("WAVE_VPI_VALUE_STORE");
+    if(_enableValueStore != nullptr) {
+        enableValueStore = std::string(_enableValueStore) == "1";
+    }
+    fmt::println("[wave_vpi] WAVE_VPI_VALUE_STORE:{}", enableValueStore);
 
-    endOfSimulation();
+    auto _valueStoreCompactDensity = std::getenv("WAVE_VPI_VALUE_STORE_COMPACT_DENSITY");
+    if(_valueStoreCompactDensity != nullptr) {
+        valueStoreCompactDensity = std::stod(_valueStoreCompactDensity);
+    }
+    fmt::println("[wave_vpi] WAVE_VPI_VALUE_STORE_COMPACT_DENSITY:{}", valueStoreCompactDensity);
 
-    exit(0);
-}
+    auto _valueStoreBudget = std::getenv("WAVE_VPI_VALUE_STORE_BUDGET_MB");
+    if(_valueStoreBudget != nullptr) {
+        valueStoreBudget.limit = std::stoull(_valueStoreBudget) * 1024 * 1024;
+        fmt::println("[wave_vpi] WAVE_VPI_VALUE_STORE_BUDGET_MB:{}", _valueStoreBudget);
+    }
 
-void sigabrt_handler(int unused) {
-    VL_WARN(R"(
----------------------------------------------------------------------
-----   wave_vpi_main get <SIGABRT>, the program will terminate...      ----
----------------------------------------------------------------------
-)");
+    auto _enableValueGroupAuto = std::getenv("WAVE_VPI_VALUE_GROUP_AUTO");
+    if(_enableValueGroupAuto != nullptr) {
+        enableValueGroupAuto = std::string(_enableValueGroupAuto) == "1";
+    }
+    fmt::println("[wave_vpi] WAVE_VPI_VALUE_GROUP_AUTO:{}", enableValueGroupAuto);
 
-    endOfSimulation();
+    auto _valueGroupProbeSteps = std::getenv("WAVE_VPI_VALUE_GROUP_PROBE_STEPS");
+    if(_valueGroupProbeSteps != nullptr) {
+        valueGroupProbeSteps = std::stoull(_valueGroupProbeSteps);
+        ASSERT(valueGroupProbeSteps > 0, "WAVE_VPI_VALUE_GROUP_PROBE_STEPS must be greater than 0");
+    }
+    if(enableValueGroupAuto) {
+        fmt::println("[wave_vpi] WAVE_VPI_VALUE_GROUP_PROBE_STEPS:{}", valueGroupProbeSteps);
+    }
 
-    exit(1);
-}
+    // Replay window, each bound is given either by time or by index, e.g.
+    //      WAVE_VPI_START_TIME=8000000 WAVE_VPI_END_TIME=9000000
+    //      WAVE_VPI_START_INDEX=100000
+    auto _startTime = std::getenv("WAVE_VPI_START_TIME");
+    auto _startIndex = std::getenv("WAVE_VPI_START_INDEX");
+    auto _endTime = std::getenv("WAVE_VPI_END_TIME");
+    auto _endIndex = std::getenv("WAVE_VPI_END_INDEX");
+    ASSERT(_startTime == nullptr || _startIndex == nullptr, "WAVE_VPI_START_TIME and WAVE_VPI_START_INDEX can not be set at the same time");
+    ASSERT(_endTime == nullptr || _endIndex == nullptr, "WAVE_VPI_END_TIME and WAVE_VPI_END_INDEX can not be set at the same time");
+    if(_startTime != nullptr || _startIndex != nullptr || _endTime != nullptr || _endIndex != nullptr) {
+        auto start = _startTime != nullptr ? windowBoundIndex(waveWindowTime, std::stoull(_startTime), true) : (_startIndex != nullptr ? std::stoull(_startIndex) : 0);
+        auto end = _endTime != nullptr ? windowBoundIndex(waveWindowTime, std::stoull(_endTime), false) : (_endIndex != nullptr ? std::stoull(_endIndex) : UINT64_MAX);
+        wave_vpi_set_window(waveWindowIndex, start, end);
+    }
 
+    auto _shards = std::getenv("WAVE_VPI_SHARDS");
+    if(_shards != nullptr) {
+        shardInfo.count = std::stoul(_shards);
+        ASSERT(shardInfo.count > 0, "WAVE_VPI_SHARDS must be greater than 0");
+    }
+    auto _shardWarmup = std::getenv("WAVE_VPI_SHARD_WARMUP");
+    if(_shardWarmup != nullptr) {
+        shardWarmup = std::stoull(_shardWarmup);
+    }
+    if(shardInfo.count > 1) {
+        fmt::println("[wave_vpi] WAVE_VPI_SHARDS:{} WAVE_VPI_SHARD_WARMUP:{}", shardInfo.count, shardWarmup);
+    }
 
-inline static void appendTimeCb() {
-    for(auto &cb : willAppendTimeCbQueue) {
-        timeCbQueue.push(cb);
-        // fmt::println("append appendTimeCb");
+    auto _enableProfile = std::getenv("WAVE_VPI_ENABLE_PROFILE");
+    if(_enableProfile != nullptr) {
+        enableProfile = std::string(_enableProfile) == "1";
     }
-    willAppendTimeCbQueue.clear();
-}
+    fmt::println("[wave_vpi] WAVE_VPI_ENABLE_PROFILE:{}", enableProfile);
 
-inline static void appendValueCb() {
-    if(!willAppendValueCb.empty()) {
-        for(auto &cb : willAppendValueCb) {
-            valueCbMap[cb.first] = cb.second;
-            // fmt::println("append {}", cb.first);
-        }
-        willAppendValueCb.clear();
+    if(enableProfile) {
+        loadProfile();
     }
 }
 
-inline static void removeValueCb() {
-    if(!willRemoveValueCb.empty()) {
-        for(auto &cb : willRemoveValueCb) {
-            valueCbMap.erase(cb);
+void endOfSimulation() {
+    static bool isEndOfSimulation = false;
+    
+    if(endOfSimulationCb && !isEndOfSimulation) {
+        isEndOfSimulation = true;
+#ifdef USE_FSDB
+        if(enableJIT && jitController.enable) {
+            jitController.report();
+        }
+        if(fsdbStreamer.enable) {
+            fsdbStreamer.report();
+        }
+#else
+        // The cache files and the profile are written once by the parent, not by every worker
+        if(shardInfo.index < 0) {
+            wellen_vpi_finalize();
+        }
+#endif
+        if(enableValueStore) {
+            fmt::println("[wave_vpi] value stores: {} value groups: {} memory: {} bytes", valueStoreCnt, valueGroups.size(), valueStoreBudget.getUsed());
+        }
+        if(enableProfile && shardInfo.index < 0) {
+            saveProfile();
+        }
+        endOfSimulationCb->cb_rtn(endOfSimulationCb.get());
+    }
+}
+
+// Sharded replay(WAVE_VPI_SHARDS=N): the replay window is split into N shards and N worker processes are forked, each one replays its shard plus WAVE_VPI_SHARD_WARMUP indices before it. The loaded wave, the value stores and the state of the scripts after the startup routines are shared copy-on-write.
+// A worker runs the normal main loop over its window and hands its results to the parent with `wave_vpi_shard_report`, usually from its endOfSimulation callback. The parent waits for all the workers, passes the results to the merge hook(see `wave_vpi_shard_set_merge`) in shard order and then calls `endOfSimulation()`.
+// This only fits analyses that can be split over time, e.g. counters and transaction logs.
+void runShards() {
+    if(shardInfo.count <= 1) {
+        return;
+    }
+    auto first = replayStartIdx;
+    auto last = std::min(replayEndIdx, cursor.maxIndex);
+    auto shardCnt = shardInfo.count;
+
+    std::vector<pid_t> pids;
+    std::vector<int> fds;
+    std::fflush(nullptr); // Buffered output would be printed once more by every worker
+    for(uint32_t k = 0; k < shardCnt; k++) {
+        int pipeFds[2];
+        ASSERT(pipe(pipeFds) == 0, "Failed to create the pipe of a shard", k);
+        auto startIdx = first + (last - first) * k / shardCnt;
+        auto endIdx = first + (last - first) * (k + 1) / shardCnt;
+
+        auto pid = fork();
+        ASSERT(pid >= 0, "Failed to fork a shard", k);
+        if(pid == 0) {
+            for(auto fd : fds) {
+                close(fd);
+            }
+            close(pipeFds[0]);
+            shardFd = pipeFds[1];
+            shardInfo.index = k;
+            shardInfo.warmupIdx = startIdx - std::min(shardWarmup, startIdx - first);
+            shardInfo.startIdx = startIdx;
+            shardInfo.endIdx = endIdx;
+
+            // The inherited file handles share their offset with the other workers
+#ifdef USE_FSDB
+            auto fsdbObj = ffrObject::ffrOpenNonSharedObj(const_cast<char *>(waveFilePath.c_str()));
+            ASSERT(fsdbObj != nullptr);
+            fsdbObj->ffrReadScopeVarTree();
+            fsdbWaveVpi->fsdbObj = fsdbObj;
+            for(auto &[name, handle] : handleCache) {
+                auto fsdbSigHdl = reinterpret_cast<FsdbSignalHandlePtr>(handle);
+                fsdbSigHdl->vcTrvsHdl = fsdbObj->ffrCreateVCTrvsHdl(fsdbSigHdl->varIdCode);
+                ASSERT(fsdbSigHdl->vcTrvsHdl != nullptr, name);
+            }
+#else
+            wellen_vpi_reopen(waveFilePath.c_str());
+#endif
+            fmt::println("[wave_vpi] shard {}/{} pid:{} warm-up index:{} index:[{}, {}]", k, shardCnt, getpid(), shardInfo.warmupIdx, startIdx, endIdx);
+            wave_vpi_set_window(waveWindowIndex, shardInfo.warmupIdx, endIdx);
+            return;
+        }
+        close(pipeFds[1]);
+        pids.emplace_back(pid);
+        fds.emplace_back(pipeFds[0]);
+    }
+
+    // A worker blocks on a full pipe until it is read, so read the results before waiting for the exits
+    std::vector<std::vector<char>> results(shardCnt);
+    for(uint32_t k = 0; k < shardCnt; k++) {
+        char buffer[65536];
+        ssize_t n;
+        while((n = read(fds[k], buffer, sizeof(buffer))) != 0) {
+            if(n < 0) {
+                ASSERT(errno == EINTR, "Failed to read the results of a shard", k, errno);
+                continue;
+            }
+            results[k].insert(results[k].end(), buffer, buffer + n);
+        }
+        close(fds[k]);
+    }
+    for(uint32_t k = 0; k < shardCnt; k++) {
+        int status;
+        ASSERT(waitpid(pids[k], &status, 0) == pids[k]);
+        ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0, "Shard failed", k, pids[k], status);
+    }
+
+    if(shardMerge != nullptr) {
+        for(uint32_t k = 0; k < shardCnt; k++) {
+            shardMerge(shardMergeContext, k, results[k].data(), results[k].size());
+        }
+    } else {
+        VL_WARN("No merge hook is set, the results of the shards are dropped\n");
+    }
+    fmt::println("[wave_vpi] FINISH! {} shards merged", shardCnt);
+
+    endOfSimulation();
+    exit(0);
+}
+
+// Shard of the current process, see `runShards()`.
+extern "C" const WaveShardInfo *wave_vpi_shard_info() { return &shardInfo; }
+
+// Append `data` to the results of the current worker, which the parent passes to the merge hook. Returns false(and drops `data`) if the current process is not a worker.
+extern "C" bool wave_vpi_shard_report(const void *data, size_t size) {
+    if(shardFd < 0) {
+        return false;
+    }
+    auto bytes = reinterpret_cast<const char *>(data);
+    while(size > 0) {
+        auto n = write(shardFd, bytes, size);
+        if(n < 0) {
+            ASSERT(errno == EINTR, "Failed to report the results of a shard", shardInfo.index, errno);
+            continue;
+        }
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Set the hook of the parent process that merges the results of the workers, it has to be set before the main loop starts(e.g. from the startup routines).
+extern "C" void wave_vpi_shard_set_merge(WaveShardMerge merge, void *context) {
+    shardMerge = merge;
+    shardMergeContext = context;
+}
+
+void sigint_handler(int unused) {
+    VL_WARN(R"(
+---------------------------------------------------------------------
+----   wave_vpi_main get <SIGINT>, the program will terminate...      ----
+---------------------------------------------------------------------
+)");
+
+    endOfSimulation();
+
+    exit(0);
+}
+
+void sigabrt_handler(int unused) {
+    VL_WARN(R"(
+---------------------------------------------------------------------
+----   wave_vpi_main get <SIGABRT>, the program will terminate...      ----
+---------------------------------------------------------------------
+)");
+
+    endOfSimulation();
+
+    exit(1);
+}
+
+
+inline static void appendTimeCb() {
+    for(auto &cb : willAppendTimeCbQueue) {
+        timeCbQueue.push(cb);
+        // fmt::println("append appendTimeCb");
+    }
+    willAppendTimeCbQueue.clear();
+}
+
+inline static void appendValueCb() {
+    if(!willAppendValueCb.empty()) {
+        for(auto &cb : willAppendValueCb) {
+            valueCbMap[cb.first] = cb.second;
+            // fmt::println("append {}", cb.first);
+        }
+        willAppendValueCb.clear();
+    }
+}
+
+inline static void removeValueCb() {
+    if(!willRemoveValueCb.empty()) {
+        for(auto &cb : willRemoveValueCb) {
+            valueCbMap.erase(cb);
             // fmt::println("remove {}", cb);
         }
         willRemoveValueCb.clear();
@@ -446,6 +1121,18 @@ void wave_vpi_main() {
     vlog_startup_routines_bootstrap();
 #endif
 
+    buildStepTimeline();
+    size_t stepPos = 0;
+
+    buildDeclaredValueGroups();
+    valueGroupProbing = enableValueGroupAuto;
+
+    // Only the workers come back, after everything above is shared with them
+    runShards();
+#ifdef USE_FSDB
+    startProfileJit();
+#endif
+
     // Call startOfSimulationCb if it exists
     if(startOfSimulationCb) {
         startOfSimulationCb->cb_rtn(startOfSimulationCb.get());
@@ -456,11 +1143,21 @@ void wave_vpi_main() {
     appendNextSimTimeCb();
     appendValueCb();
 
-    // Start wave_vpi evaluation loop
+    // Start wave_vpi evaluation loop, a seek from startOfSimulationCb only sets where it starts
+    cursorSeeked = false;
+    replayStarted = true;
     ASSERT(cursor.maxIndex != 0);
     fmt::println("[wave_vpi] START! cursor.maxIndex => {} cursor.maxTime => {}", cursor.maxIndex, cursor.maxTime);
 
-    while(cursor.index < cursor.maxIndex) {
+    auto endIdx = std::min(replayEndIdx, cursor.maxIndex);
+    while(cursor.index < endIdx) {
+#ifdef USE_FSDB
+        if(fsdbStreamer.enable) {
+            fsdbStreamer.advance(cursor.index);
+        }
+#endif
+        updateValueSlots();
+
         // Deal with cbAfterDelay(time) callbacks
         if(!timeCbQueue.empty()) {
             bool again = cursor.index >= timeCbQueue.front().first;
@@ -479,6 +1176,15 @@ void wave_vpi_main() {
                 ASSERT(cb.second.cbData->obj != nullptr);
                 ASSERT(cb.second.cbData->cb_rtn != nullptr);
 
+                if(cb.second.bundle != nullptr) {
+                    gatherBundle(cb.second.bundle);
+                    if(cb.second.bundle->value.seq != cb.second.bundleSeq) {
+                        cb.second.bundleSeq = cb.second.bundle->value.seq;
+                        cb.second.cbData->cb_rtn(cb.second.cbData.get());
+                    }
+                    continue;
+                }
+
                 auto misMatch = false;
 #ifdef USE_FSDB
                 uint32_t newBitValue = 0;
@@ -497,7 +1203,7 @@ void wave_vpi_main() {
                     }
                 }
 #else
-                auto newValueStr = _wellen_get_value_str(&cb.second.handle);
+                auto newValueStr = _wellen_get_value_str(cb.second.handle);
                 if(newValueStr != cb.second.valueStr) {
                     misMatch = true;
                     cb.second.valueStr = newValueStr;
@@ -511,12 +1217,13 @@ void wave_vpi_main() {
 #ifdef USE_FSDB
                             if(cb.second.bitSize == 1) [[likely]] {
                                 cb.second.cbData->value->value.integer = newBitValue;
-                            } else [[unlikely]] {
-                                cb.second.cbData->value->value.integer = std::stoi(newValueStr); // TODO: it seems incorrect?
+                                break;
                             }
-#else
-                            cb.second.cbData->value->value.integer = std::stoi(newValueStr); // TODO: it seems incorrect?
 #endif
+                            // The string may hold `x`/`z`, take the lowest word of the vector with X and Z read as 0
+                            s_vpi_value v{.format = vpiVectorVal};
+                            vpi_get_value(cb.second.handle, &v);
+                            cb.second.cbData->value->value.integer = v.value.vector[0].aval & ~v.value.vector[0].bval;
                             break;
                         }
                         default:
@@ -538,14 +1245,36 @@ void wave_vpi_main() {
         removeValueCb(); // Remove finished cbValueChange callbacks
         appendValueCb(); // Register newly registered cbValueChange callbacks from the previous cbNextSimTime callback
 
-        cursor.index++; // Next simulation step
-    }
-    
 #ifdef USE_FSDB
-    fmt::println("[wave_vpi] FINISH! cursor.index => {} cursor.time => {}", cursor.index, fsdbWaveVpi->xtagU64Vec[cursor.index]);
-#else
-    fmt::println("[wave_vpi] FINISH! cursor.index => {} cursor.time => {}", cursor.index, wellen_get_time_from_index(cursor.index));
+        if(enableJIT && jitController.enable) {
+            jitController.tick(cursor.index);
+        }
 #endif
+
+        if(valueGroupProbing) [[unlikely]] {
+            if(++valueGroupProbeStep >= valueGroupProbeSteps) {
+                valueGroupProbing = false;
+                buildAutoValueGroups();
+            }
+        }
+
+        // Next simulation step
+        if(cursorSeeked) [[unlikely]] {
+            cursorSeeked = false;
+        } else if(stepIndices.empty()) [[likely]] {
+            cursor.index++;
+        } else {
+            while(stepPos < stepIndices.size() && stepIndices[stepPos] <= cursor.index) {
+                stepPos++;
+            }
+            cursor.index = stepPos < stepIndices.size() ? stepIndices[stepPos] : cursor.maxIndex;
+        }
+    }
+    
+    if(cursor.index > endIdx) {
+        cursor.updateIndex(endIdx); // The last step may jump over the end of the replay window
+    }
+    fmt::println("[wave_vpi] FINISH! cursor.index => {} cursor.time => {}", cursor.index, timeTable[cursor.index]);
     
     // End of simulation
     endOfSimulation();
@@ -576,6 +1305,12 @@ vpiHandle vpi_put_value(vpiHandle object, p_vpi_value value_p, p_vpi_time time_p
 vpiHandle vpi_handle_by_name(PLI_BYTE8 *name, vpiHandle scope) {
     // TODO: scope
     ASSERT(scope == nullptr);
+
+    auto it = handleCache.find(std::string(name));
+    if(it != handleCache.end()) {
+        return it->second;
+    }
+
 #ifdef USE_FSDB
     auto varIdCode = fsdbWaveVpi->getVarIdCodeByName(name);
     auto hdl = fsdbWaveVpi->fsdbObj->ffrCreateVCTrvsHdl(varIdCode);
@@ -589,18 +1324,35 @@ vpiHandle vpi_handle_by_name(PLI_BYTE8 *name, vpiHandle scope) {
         .varIdCode = varIdCode,
         .bitSize = hdl->ffrGetBitSize()
     };
+    fsdbSigHdl->vecvalBuffer.resize((fsdbSigHdl->bitSize + 31) / 32);
+    fsdbSigHdl->wordBuffer.resize((fsdbSigHdl->bitSize + 31) / 32);
+    fsdbSigHdl->strBuffer.resize(fsdbSigHdl->bitSize + 1);
 
     auto vpiHdl = reinterpret_cast<vpiHandle>(fsdbSigHdl);
 #else
-    auto vpiHdl = reinterpret_cast<vpiHandle>(wellen_vpi_handle_by_name(name)); 
+    auto wellenHdl = wellen_vpi_handle_by_name(name);
+    auto wellenSigHdl = new WellenSignalHandle {
+        .name = std::string(name),
+        .wellenHdl = wellenHdl,
+        .bitSize = static_cast<size_t>(wellen_vpi_get(vpiSize, wellenHdl))
+    };
+    wellenSigHdl->vecvalBuffer.resize(std::max<size_t>((wellenSigHdl->bitSize + 31) / 32, 1));
+    wellenSigHdl->strBuffer.resize(wellenSigHdl->bitSize + 1);
+
+    auto vpiHdl = reinterpret_cast<vpiHandle>(wellenSigHdl);
 #endif
+    if(enableAnalyticClock || enableValueStore) {
+        setupValueStore(vpiHdl);
+    }
+
     // hdlToNameMap[vpiHdl] = std::string(name); // For debug purpose
+    handleCache[std::string(name)] = vpiHdl;
     return vpiHdl;
 }
 
 #ifdef USE_FSDB
 
-void optThreadTask(std::string fsdbFileName, std::vector<fsdbXTag> xtagVec, FsdbSignalHandlePtr fsdbSigHdl) {
+void optThreadTask(std::string fsdbFileName, FsdbSignalHandlePtr fsdbSigHdl) {
     static std::mutex optMutex;
 
     // Ensure only one `fsdbObj` can be processed for all the optimization threads. (It seems like a bug that FsdbReader did not allow multiple ffrObjects to be processed at multiple threads. )
@@ -616,92 +1368,94 @@ void optThreadTask(std::string fsdbFileName, std::vector<fsdbXTag> xtagVec, Fsdb
     ASSERT(bitSize <= 32, "For now we only optimize signals with bitSize <= 32");
   
     auto &optValueVec = fsdbSigHdl->optValueVec;
-    optValueVec.reserve(xtagVec.size());
 
+    // Windows always end at a block boundary so that the blocks being written are never visible to the reader.
     auto currentCursorIdx = cursor.index;
-    auto optFinishIdx = currentCursorIdx + jitCompileWindowSize;
+    auto optFinishIdx = alignToBlock(currentCursorIdx + jitCompileWindowSize);
 
-    if(optFinishIdx >= xtagVec.size()) {
-        optFinishIdx = xtagVec.size() - 1;
+    if(optFinishIdx >= timeTable.size()) {
+        optFinishIdx = timeTable.size() - 1;
     }
 
-    auto optFunc = [&hdl, &xtagVec, &bitSize, &fsdbFileName, fsdbSigHdl](size_t startIdx, size_t finishIdx) {
+    // Written by the windows before they are published through `optFinishIdx`, never resized afterwards
+    fsdbSigHdl->optBlockKnownFrom.assign((timeTable.size() + VALUE_STORE_BLOCK_MASK) >> VALUE_STORE_BLOCK_SHIFT, 0);
+
+    auto &kernels = bitConvert();
+    auto decodeFunc = [&hdl, &bitSize, &fsdbFileName, &kernels, fsdbSigHdl](size_t idx) -> uint32_t {
         byte_T *retVC;
         fsdbBytesPerBit bpb;
+        uint32_t tmpVal = 0;
+        auto time = UInt64ToXtag(timeTable[idx]);
+        time.hltag.L = time.hltag.L + 1;
 
-        auto &optValueVec = fsdbSigHdl->optValueVec;
+        if(FSDB_RC_SUCCESS != hdl->ffrGotoXTag(&time)) [[unlikely]] {
+            PANIC("Failed to call hdl->ffrGotoXtag()", time.hltag.L, time.hltag.H, idx, fsdbSigHdl->name, fsdbFileName);
+        }
 
-        for(auto idx = startIdx; idx < finishIdx; idx++) {
-            uint32_t tmpVal = 0;
-            auto time = xtagVec[idx];
-            time.hltag.L = time.hltag.L + 1;
+        if(FSDB_RC_SUCCESS != hdl->ffrGetVC(&retVC)) [[unlikely]] {
+            PANIC("hdl->ffrGetVC() failed!");
+        }
 
-            if(FSDB_RC_SUCCESS != hdl->ffrGotoXTag(&time)) [[unlikely]] {
-                PANIC("Failed to call hdl->ffrGotoXtag()", time.hltag.L, time.hltag.H, idx, fsdbSigHdl->name, fsdbFileName);
-            }
+        bpb = hdl->ffrGetBytesPerBit();
+        if(bpb != FSDB_BYTES_PER_BIT_1B) [[unlikely]] {
+            PANIC("TODO: FSDB_BYTES_PER_BIT_4B/8B", bpb);
+        }
 
-            if(FSDB_RC_SUCCESS != hdl->ffrGetVC(&retVC)) [[unlikely]] {
-                PANIC("hdl->ffrGetVC() failed!");
-            }
+        // `X`/`Z` are stored as `0`, the indices of a block up to its last unknown value are left to the FSDB reader.
+        uint32_t unknownBits = 0;
+        if(bitSize == 1) {
+            tmpVal = retVC[0] == FSDB_BT_VCD_1;
+            unknownBits = retVC[0] == FSDB_BT_VCD_X || retVC[0] == FSDB_BT_VCD_Z;
+        } else {
+            uint32_t vecval[2];
+            kernels.packFourState(retVC, bitSize, vecval);
+            unknownBits = vecval[1];
+            tmpVal = vecval[0] & ~unknownBits;
+        }
+        if(unknownBits != 0) [[unlikely]] {
+            fsdbSigHdl->optBlockKnownFrom[idx >> VALUE_STORE_BLOCK_SHIFT] = (idx & VALUE_STORE_BLOCK_MASK) + 1;
+        }
+        return tmpVal;
+    };
 
-            bpb = hdl->ffrGetBytesPerBit();
+    auto optFunc = [&decodeFunc, &optValueVec](size_t startIdx, size_t finishIdx) {
+        auto startTime = std::chrono::steady_clock::now();
+        for(auto idx = startIdx; idx < finishIdx; idx++) {
+            optValueVec.set(idx, decodeFunc(idx));
+        }
+        optValueVec.seal(startIdx, finishIdx);
+        jitController.recordRefill(finishIdx - startIdx, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count());
+    };
 
-            if(bitSize == 1) {
-                switch (bpb) {
-                [[likely]] case FSDB_BYTES_PER_BIT_1B: {
-                    switch (retVC[0]) {
-                        case FSDB_BT_VCD_X: // treat `X` as `0`
-                        case FSDB_BT_VCD_Z: // treat `Z` as `0`
-                        case FSDB_BT_VCD_0:
-                            optValueVec[idx] = 0;
-                            break;
-                        case FSDB_BT_VCD_1:
-                            optValueVec[idx] = 1;
-                            break;
-                        default:
-                            PANIC("unknown verilog bit type found.");
-                    }
-                    break;
-                }
-                case FSDB_BYTES_PER_BIT_4B:
-                case FSDB_BYTES_PER_BIT_8B:
-                    PANIC("TODO: FSDB_BYTES_PER_BIT_4B/8B", bpb);
-                    break;
-                default:
-                    PANIC("Should not reach here!");
-                }
-            } else {
-                switch (bpb) {
-                [[likely]] case FSDB_BYTES_PER_BIT_1B: {
-                    for (int i = 0; i < bitSize; i++) {
-                        switch (retVC[i]) {
-                        case FSDB_BT_VCD_X: // treat `X` as `0`
-                        case FSDB_BT_VCD_Z: // treat `Z` as `0`
-                        case FSDB_BT_VCD_0:
-                            break;
-                        case FSDB_BT_VCD_1:
-                            tmpVal += 1 << (bitSize - i - 1);
-                            break;
-                        default:
-                            PANIC("unknown verilog bit type found.");
-                        }
-                    }
-                    break;
-                }
-                case FSDB_BYTES_PER_BIT_4B:
-                case FSDB_BYTES_PER_BIT_8B:
-                    PANIC("TODO: FSDB_BYTES_PER_BIT_4B/8B", bpb);
-                    break;
-                default:
-                    PANIC("Should not reach here!");
-                }
-                optValueVec[idx] = tmpVal;
+    // The first window is decoded into a temporary buffer, its change density decides which layout is used for the whole signal.
+    {
+        std::vector<uint32_t> firstWindow;
+        firstWindow.reserve(optFinishIdx - currentCursorIdx);
+
+        uint64_t changeCnt = 0;
+        for(auto idx = currentCursorIdx; idx < optFinishIdx; idx++) {
+            auto value = decodeFunc(idx);
+            if(!firstWindow.empty() && firstWindow.back() != value) {
+                changeCnt++;
             }
+            firstWindow.emplace_back(value);
         }
-    };
 
-    optFunc(currentCursorIdx, optFinishIdx);
+        // The whole signal is assumed to change as often as the first window.
+        auto layout = AdaptiveValueVec<uint32_t>::chooseLayout(changeCnt, firstWindow.size(), jitCompactDensity);
+        auto estimatedChangeCnt = firstWindow.empty() ? 0 : changeCnt * timeTable.size() / firstWindow.size();
+        if(!reserveValueStore(layout, estimatedChangeCnt, timeTable.size())) {
+            layout = AdaptiveValueVec<uint32_t>::Layout::ChangePoint;
+            VL_WARN("valueStoreBudget is exhausted, JIT of {} falls back to the change-point layout\n", fsdbSigHdl->name);
+        }
+        optValueVec.init(timeTable.size(), layout);
+        for(size_t i = 0; i < firstWindow.size(); i++) {
+            optValueVec.set(currentCursorIdx + i, firstWindow[i]);
+        }
+        optValueVec.seal(currentCursorIdx, optFinishIdx);
+    }
 
+    fsdbSigHdl->optStartIdx = currentCursorIdx;
     fsdbSigHdl->optFinish = true;
     fsdbSigHdl->optFinishIdx = optFinishIdx;
 
@@ -714,7 +1468,7 @@ void optThreadTask(std::string fsdbFileName, std::vector<fsdbXTag> xtagVec, Fsdb
     }
 
     if(verbose_jit) {
-        fmt::println("[optThreadTask] First optimization finish! {} currentCursorIdx:{} optFinishIdx:{}", fsdbSigHdl->name, currentCursorIdx, optFinishIdx);
+        fmt::println("[optThreadTask] First optimization finish! {} currentCursorIdx:{} optFinishIdx:{} layout:{}", fsdbSigHdl->name, currentCursorIdx, optFinishIdx, optValueVec.layoutName());
     }
 
     int optCnt = 0;
@@ -725,10 +1479,10 @@ void optThreadTask(std::string fsdbFileName, std::vector<fsdbXTag> xtagVec, Fsdb
 
         // Continue optimization
         auto optFinish = false;
-        auto optStartIdx = fsdbSigHdl->optFinishIdx;
-        auto optFinishIdx = fsdbSigHdl->optFinishIdx + jitCompileWindowSize;
-        if(optFinishIdx >= xtagVec.size()) {
-            optFinishIdx = xtagVec.size() - 1;
+        uint64_t optStartIdx = fsdbSigHdl->optFinishIdx;
+        auto optFinishIdx = alignToBlock(fsdbSigHdl->optFinishIdx + jitCompileWindowSize);
+        if(optFinishIdx >= timeTable.size()) {
+            optFinishIdx = timeTable.size() - 1;
             optFinish = true;
         }
         optFunc(optStartIdx, optFinishIdx);
@@ -751,304 +1505,999 @@ void optThreadTask(std::string fsdbFileName, std::vector<fsdbXTag> xtagVec, Fsdb
 
     // fsdbObj->ffrClose();
     if(verbose_jit) {
-        fmt::println("[optThreadTask] Optimization finish! total compile times:{} signalName:{}", optCnt, fsdbSigHdl->name);
+        fmt::println("[optThreadTask] Optimization finish! total compile times:{} signalName:{} layout:{} memoryUsage:{}", optCnt, fsdbSigHdl->name, optValueVec.layoutName(), optValueVec.memoryUsage());
         optCnt++;
     }
 }
+
+// Start the optimization thread of `fsdbSigHdl` if there is still an optimization thread available.
+inline static bool jitStartOpt(FsdbSignalHandlePtr fsdbSigHdl) {
+    // No thread may be running when the workers of a sharded replay are forked, see `runShards()`
+    if(shardInfo.count > 1 && !replayStarted) {
+        return false;
+    }
+    auto _jitOptThreadCnt = jitOptThreadCnt.load();
+    if(_jitOptThreadCnt <= jitMaxOptThreads) {
+        jitOptThreadCnt.store(_jitOptThreadCnt + 1);
+        fsdbSigHdl->doOpt = true;
+        fsdbSigHdl->continueOpt = false;
+        fsdbSigHdl->optThread = std::thread(std::bind(optThreadTask, fsdbWaveVpi->waveFileName, fsdbSigHdl));
+        return true;
+    }
+    return false;
+}
 #endif
 
-void vpi_get_value(vpiHandle object, p_vpi_value value_p) {
+// Fill `value_p` from the value of a signal with at most 32 bits. The vector and the strings are written into the output buffers of `sigHdl`.
+template <PLI_INT32 format>
+inline static void fillNarrowValue(SignalHandlePtr sigHdl, p_vpi_value value_p, uint32_t value, size_t bitSize) {
+    if constexpr (format == vpiIntVal) {
+        value_p->value.integer = value;
+    } else if constexpr (format == vpiVectorVal) {
+        auto vecvals = sigHdl->vecvalBuffer.data();
+        vecvals[0].aval = value;
+        vecvals[0].bval = 0;
+        value_p->value.vector = vecvals;
+    } else if constexpr (format == vpiHexStrVal) {
+        auto &str = sigHdl->strBuffer;
+        snprintf(str.data(), str.size(), "%x", value);
+        value_p->value.str = str.data();
+    } else {
+        static_assert(format == vpiBinStrVal);
+        auto buffer = sigHdl->strBuffer.data();
+        for (size_t i = 0; i < bitSize; i++) {
+            buffer[bitSize - 1 - i] = (value & (1U << i)) ? '1' : '0';
+        }
+        buffer[bitSize] = '\0';
+        value_p->value.str = buffer;
+    }
+}
+
+// Mark the current probe step in the co-access bitmap of a signal, see `buildAutoValueGroups()`.
+inline static void recordCoAccess(SignalHandlePtr sigHdl) {
+    auto &steps = sigHdl->coAccessSteps;
+    if(steps.empty()) {
+        steps.resize((valueGroupProbeSteps + 63) >> 6, 0);
+    }
+    auto &word = steps[valueGroupProbeStep >> 6];
+    auto mask = 1ULL << (valueGroupProbeStep & 63);
+    if((word & mask) == 0) {
+        word |= mask;
+        sigHdl->coAccessCnt++;
+    }
+}
+
+// Width classes of the prebound value getters, see `bindValueGetter()`.
+enum class ValueWidth { Bit, Word, DoubleWord, Wide };
+
+// Read the value at `cursor.index` from the wave file.
+template <PLI_INT32 format, ValueWidth width>
+struct WaveValueGetter {
+    static void get(vpiHandle object, p_vpi_value value_p) {
 #ifdef USE_FSDB
-    static byte_T buffer[FSDB_MAX_BIT_SIZE + 1];
-    static s_vpi_vecval vpiValueVecs[100];
-    auto fsdbSigHdl = reinterpret_cast<FsdbSignalHandlePtr>(object);
-    
-    if(!enableJIT) goto ReadFromFSDB;
+        auto fsdbSigHdl = reinterpret_cast<FsdbSignalHandlePtr>(object);
+        auto vcTrvsHdl = fsdbSigHdl->vcTrvsHdl;
+        byte_T *retVC;
+        fsdbBytesPerBit bpb;
+        size_t bitSize = fsdbSigHdl->bitSize;
+
+        if(fsdbSigHdl->streamed && !cursorShifted) {
+            retVC = fsdbSigHdl->streamVC.data();
+            bpb = fsdbSigHdl->streamBpb;
+        } else {
+            if(fsdbStreamer.enable && fsdbSigHdl->readCnt > jitHotAccessThreshold) [[unlikely]] {
+                fsdbStreamer.addSignal(fsdbSigHdl);
+            }
+
+            auto time = UInt64ToXtag(timeTable[cursor.index]);
+            time.hltag.L = time.hltag.L + 1; // Move a little bit further to ensure we are not in the sensitive clock edge which may lead to signal value confusion.
+
+            if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGotoXTag(&time)) [[unlikely]] {
+                auto currIndexTime = timeTable[cursor.index];
+                auto maxIndexTime = timeTable[cursor.maxIndex];
+                PANIC("vcTrvsHdl->ffrGotoXTag() failed!", time.hltag.L, time.hltag.H, maxIndexTime, currIndexTime, cursor.maxIndex, cursor.index);
+            }
+            if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGetVC(&retVC)) [[unlikely]] {
+                PANIC("vcTrvsHdl->ffrGetVC() failed!");
+            }
+
+            bpb = vcTrvsHdl->ffrGetBytesPerBit();
+        }
 
-    if(fsdbSigHdl->optFinish) {
+        if(bpb != FSDB_BYTES_PER_BIT_1B) [[unlikely]] {
+            PANIC("TODO: FSDB_BYTES_PER_BIT_4B/8B", bpb);
+        }
+
+        // `retVC` holds one byte per bit, see bit_convert.h. A single bit is decoded from its code directly: 0 => `0`, 1 => `1`, 2 => `X`, 3 => `Z`.
+        auto &kernels = bitConvert();
+        if constexpr (format == vpiIntVal) {
+            if constexpr (width == ValueWidth::Bit) {
+                value_p->value.integer = retVC[0] == FSDB_BT_VCD_1;
+            } else {
+                auto intBitSize = width == ValueWidth::Word ? bitSize : 32;
+                uint32_t word;
+                kernels.packWords(retVC + bitSize - intBitSize, intBitSize, &word);
+                value_p->value.integer = word;
+            }
+        } else if constexpr (format == vpiVectorVal) {
+            // `s_vpi_vecval` is the interleaved `aval`/`bval` layout written by `packFourState`
+            static_assert(sizeof(s_vpi_vecval) == 2 * sizeof(uint32_t));
+            auto vecvals = fsdbSigHdl->vecvalBuffer.data();
+            if constexpr (width == ValueWidth::Bit) {
+                uint32_t lo = retVC[0] & 1, hi = (retVC[0] >> 1) & 1;
+                vecvals[0].aval = lo ^ hi;
+                vecvals[0].bval = hi;
+            } else {
+                kernels.packFourState(retVC, bitSize, reinterpret_cast<uint32_t *>(vecvals));
+            }
+            value_p->value.vector = vecvals;
+        } else if constexpr (format == vpiHexStrVal) {
+            auto str = fsdbSigHdl->strBuffer.data();
+            if constexpr (width == ValueWidth::Bit) {
+                str[0] = "01xz"[retVC[0] & 3];
+                str[1] = '\0';
+            } else if constexpr (width != ValueWidth::Wide) {
+                uint32_t vecvals[4];
+                if(kernels.packFourState(retVC, bitSize, vecvals)) [[unlikely]] {
+                    fourStateWordsToHexStr(vecvals, bitSize, str);
+                } else {
+                    uint32_t words[2] = {vecvals[0], vecvals[2]};
+                    kernels.wordsToHexStr(words, bitSize, str);
+                }
+            } else {
+                auto vecvals = reinterpret_cast<uint32_t *>(fsdbSigHdl->vecvalBuffer.data());
+                if(kernels.packFourState(retVC, bitSize, vecvals)) [[unlikely]] {
+                    fourStateWordsToHexStr(vecvals, bitSize, str);
+                } else {
+                    auto &words = fsdbSigHdl->wordBuffer;
+                    for (size_t i = 0; i < words.size(); i++) {
+                        words[i] = vecvals[2 * i];
+                    }
+                    kernels.wordsToHexStr(words.data(), bitSize, str);
+                }
+            }
+            value_p->value.str = str;
+        } else {
+            static_assert(format == vpiBinStrVal);
+            kernels.toBinStr(retVC, bitSize, fsdbSigHdl->strBuffer.data());
+            value_p->value.str = fsdbSigHdl->strBuffer.data();
+        }
+#else
+        // wellen decodes the value on its side, the width class does not matter here
+        auto wellenSigHdl = reinterpret_cast<WellenSignalHandlePtr>(object);
+        if constexpr (format == vpiVectorVal) {
+            wellen_vpi_get_vector_from_index(wellenSigHdl->wellenHdl, cursor.index, wellenSigHdl->vecvalBuffer.data(), wellenSigHdl->vecvalBuffer.size());
+            value_p->value.vector = wellenSigHdl->vecvalBuffer.data();
+        } else {
+            wellen_vpi_get_value_from_index(wellenSigHdl->wellenHdl, cursor.index, value_p);
+            if constexpr (format == vpiHexStrVal) {
+                // The hex string of wellen is shared by all the signals, keep a copy of our own
+                auto &str = wellenSigHdl->strBuffer;
+                strncpy(str.data(), value_p->value.str, str.size() - 1);
+                str.back() = '\0';
+                value_p->value.str = str.data();
+            }
+        }
+#endif
+    }
+};
+
+// The value group, value store and periodic clock are two-state, indices before `knownFromIdx` are read from the wave file.
+template <PLI_INT32 format, ValueWidth width>
+struct GroupValueGetter {
+    static void get(vpiHandle object, p_vpi_value value_p) {
+        auto sigHdl = reinterpret_cast<SignalHandlePtr>(object);
+        if(cursor.index < sigHdl->knownFromIdx) [[unlikely]] {
+            return WaveValueGetter<format, width>::get(object, value_p);
+        }
+        fillNarrowValue<format>(sigHdl, value_p, sigHdl->group->get(cursor.index, sigHdl->groupSlot), sigHdl->bitSize);
+    }
+};
+
+template <PLI_INT32 format, ValueWidth width>
+struct StoredValueGetter {
+    static void get(vpiHandle object, p_vpi_value value_p) {
+        auto sigHdl = reinterpret_cast<SignalHandlePtr>(object);
+        if(cursor.index < sigHdl->knownFromIdx) [[unlikely]] {
+            return WaveValueGetter<format, width>::get(object, value_p);
+        }
+        fillNarrowValue<format>(sigHdl, value_p, sigHdl->valueStore.get(cursor.index), sigHdl->bitSize);
+    }
+};
+
+template <PLI_INT32 format, ValueWidth width>
+struct PeriodicValueGetter {
+    static void get(vpiHandle object, p_vpi_value value_p) {
+        auto sigHdl = reinterpret_cast<SignalHandlePtr>(object);
+        if(cursor.index < sigHdl->knownFromIdx) [[unlikely]] {
+            return WaveValueGetter<format, width>::get(object, value_p);
+        }
+        fillNarrowValue<format>(sigHdl, value_p, sigHdl->periodicClock.valueAt(timeTable[cursor.index]), 1);
+    }
+};
+
+#ifdef USE_FSDB
+static void bindValueGetter(SignalHandlePtr sigHdl, PLI_INT32 format);
+
+// Read from `optValueVec` once the first optimization window is finished.
+template <PLI_INT32 format, ValueWidth width>
+struct JitValueGetter {
+    static void get(vpiHandle object, p_vpi_value value_p) {
+        auto fsdbSigHdl = reinterpret_cast<FsdbSignalHandlePtr>(object);
+        jitController.readCnt++;
         if(cursor.index >= fsdbSigHdl->optFinishIdx) {
             // fmt::println("[WARN] JIT need recompile! cursor.index:{} optFinishIdx:{} signalName:{}", cursor.index, fsdbSigHdl->optFinishIdx, fsdbSigHdl->name);
-            goto ReadFromFSDB;
-        } else if(cursor.index >= (fsdbSigHdl->optFinishIdx - jitRecompileWindowSize)) {
+            jitController.stallCnt++;
+            return WaveValueGetter<format, width>::get(object, value_p);
+        } else if(cursor.index + jitRecompileWindowSize >= fsdbSigHdl->optFinishIdx) {
             // fmt::println("[WARN] continue optimization... {} cursot.index:{} optFinishIdx:{}", fsdbSigHdl->name, cursor.index, fsdbSigHdl->optFinishIdx);
             fsdbSigHdl->continueOpt = true;
             fsdbSigHdl->cv.notify_all();
         }
 
-        switch (value_p->format) {
-        case vpiIntVal: {
-            value_p->value.integer = fsdbSigHdl->optValueVec[cursor.index];
-            return;
+        // Before the first window(e.g. a read at a negative offset, see `getValueAtIndex()`), or a value that may hold `X`/`Z`
+        if(cursor.index < fsdbSigHdl->optStartIdx || (cursor.index & VALUE_STORE_BLOCK_MASK) < fsdbSigHdl->optBlockKnownFrom[cursor.index >> VALUE_STORE_BLOCK_SHIFT]) [[unlikely]] {
+            return WaveValueGetter<format, width>::get(object, value_p);
         }
-        case vpiVectorVal: {
-            vpiValueVecs[0].aval = fsdbSigHdl->optValueVec[cursor.index];
-            vpiValueVecs[0].bval = 0;
-            value_p->value.vector = vpiValueVecs;
-            return;
+        fillNarrowValue<format>(fsdbSigHdl, value_p, fsdbSigHdl->optValueVec.get(cursor.index), fsdbSigHdl->bitSize);
+    }
+};
+
+// Read from the FSDB until the signal gets hot enough for the JIT-like optimization, and switch to `JitValueGetter` once it is finished.
+template <PLI_INT32 format, ValueWidth width>
+struct JitPendingValueGetter {
+    static void get(vpiHandle object, p_vpi_value value_p) {
+        auto fsdbSigHdl = reinterpret_cast<FsdbSignalHandlePtr>(object);
+        if(fsdbSigHdl->optFinish) {
+            bindValueGetter(fsdbSigHdl, format);
+            return fsdbSigHdl->getter(object, value_p);
         }
-        case vpiHexStrVal: {
-            const int bufferSize = 8; // TODO: 4 * 8 = 32, if support 64 bit signal, this value should be set to 16. 
-            snprintf(reinterpret_cast<char *>(buffer), bufferSize, "%x", fsdbSigHdl->optValueVec[cursor.index]);
-            value_p->value.str = (char *)buffer;
-            return;
+        // Doing somthing like JIT(Just-In-Time)...
+        if(!fsdbSigHdl->doOpt && fsdbSigHdl->readCnt > jitHotAccessThreshold) {
+            jitStartOpt(fsdbSigHdl);
+        }
+        WaveValueGetter<format, width>::get(object, value_p);
+    }
+};
+#endif
+
+template <template <PLI_INT32, ValueWidth> class Getter, ValueWidth width>
+static ValueGetter valueGetterFor(PLI_INT32 format) {
+    switch (format) {
+    case vpiIntVal:
+        return Getter<vpiIntVal, width>::get;
+    case vpiVectorVal:
+        return Getter<vpiVectorVal, width>::get;
+    case vpiHexStrVal:
+        return Getter<vpiHexStrVal, width>::get;
+    case vpiBinStrVal:
+        return Getter<vpiBinStrVal, width>::get;
+    default:
+        PANIC("Unsupported!", format);
+    }
+}
+
+template <template <PLI_INT32, ValueWidth> class Getter>
+static ValueGetter valueGetterFor(PLI_INT32 format, size_t bitSize) {
+    if(bitSize == 1) {
+        return valueGetterFor<Getter, ValueWidth::Bit>(format);
+    } else if(bitSize <= 32) {
+        return valueGetterFor<Getter, ValueWidth::Word>(format);
+    } else if(bitSize <= 64) {
+        return valueGetterFor<Getter, ValueWidth::DoubleWord>(format);
+    }
+    return valueGetterFor<Getter, ValueWidth::Wide>(format);
+}
+
+// Bind the getter of `sigHdl` for `format`, specialized for where the value is read from and for the width class of the signal. This leaves `vpi_get_value` with one indirect call instead of checking the storages, the JIT state, the format and the width on every read.
+// The getter is bound again on the next read(by resetting `getterFormat`) whenever the storage of the signal changes.
+static void bindValueGetter(SignalHandlePtr sigHdl, PLI_INT32 format) {
+    auto bitSize = sigHdl->bitSize;
+    if(sigHdl->group != nullptr) {
+        sigHdl->getter = valueGetterFor<GroupValueGetter>(format, bitSize);
+    } else if(sigHdl->stored) {
+        sigHdl->getter = valueGetterFor<StoredValueGetter>(format, bitSize);
+    } else if(sigHdl->periodic) {
+        sigHdl->getter = valueGetterFor<PeriodicValueGetter>(format, bitSize);
+#ifdef USE_FSDB
+    } else if(enableJIT && sigHdl->optFinish) {
+        sigHdl->getter = valueGetterFor<JitValueGetter>(format, bitSize);
+    } else if(enableJIT && bitSize <= 32) {
+        sigHdl->getter = valueGetterFor<JitPendingValueGetter>(format, bitSize);
+#endif
+    } else {
+        sigHdl->getter = valueGetterFor<WaveValueGetter>(format, bitSize);
+    }
+    sigHdl->getterFormat = format;
+}
+
+void vpi_get_value(vpiHandle object, p_vpi_value value_p) {
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(object);
+    sigHdl->readCnt++;
+    if(valueGroupProbing) [[unlikely]] {
+        recordCoAccess(sigHdl);
+    }
+
+    if(sigHdl->getterFormat != value_p->format) [[unlikely]] {
+        bindValueGetter(sigHdl, value_p->format);
+    }
+    sigHdl->getter(object, value_p);
+}
+
+inline static void updateValueSlot(SignalHandlePtr sigHdl) {
+    auto slot = sigHdl->valueSlot.get();
+    if(slot->index == cursor.index) {
+        return;
+    }
+    slot->index = cursor.index;
+
+    s_vpi_value v{.format = vpiVectorVal};
+    vpi_get_value(reinterpret_cast<vpiHandle>(sigHdl), &v);
+    auto bytes = slot->wordCnt * sizeof(s_vpi_vecval);
+    if(std::memcmp(slot->vecvals, v.value.vector, bytes) != 0) {
+        std::memcpy(slot->vecvals, v.value.vector, bytes);
+        slot->seq++;
+    }
+}
+
+// Refresh the value slots at `cursor.index`, called by the main loop before the callbacks of each step.
+void updateValueSlots() {
+    for(auto sigHdl : valueSlotHdls) {
+        updateValueSlot(sigHdl);
+    }
+}
+
+// Register a value slot for `handle` and return its address, which stays valid until the end of the simulation. Registering a handle twice returns the same slot.
+// The slot always holds the value of the signal at the current step, so a script binding can read it and compare `seq` with plain loads instead of calling `vpi_get_value`.
+extern "C" ValueSlot *wave_vpi_register_value_slot(vpiHandle handle) {
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+    if(sigHdl->valueSlot == nullptr) {
+        auto wordCnt = std::max<size_t>((sigHdl->bitSize + 31) / 32, 1);
+        sigHdl->valueSlotVecvals.assign(wordCnt, s_vpi_vecval{.aval = 0, .bval = 0});
+        sigHdl->valueSlot = std::make_unique<ValueSlot>(ValueSlot{
+            .seq = 0,
+            .index = UINT64_MAX,
+            .bitSize = static_cast<uint32_t>(sigHdl->bitSize),
+            .wordCnt = static_cast<uint32_t>(wordCnt),
+            .vecvals = sigHdl->valueSlotVecvals.data(),
+        });
+        valueSlotHdls.emplace_back(sigHdl);
+        updateValueSlot(sigHdl);
+    }
+    return sigHdl->valueSlot.get();
+}
+
+// Number of `s_vpi_vecval` words of a value of `sigHdl`.
+inline static size_t vecvalWordCnt(SignalHandlePtr sigHdl) { return std::max<size_t>((sigHdl->bitSize + 31) / 32, 1); }
+
+// True if the value of `sigHdl` at `idx` is kept by a two-state storage, see `twoStateValueAt()`.
+inline static bool hasTwoStateValue(SignalHandlePtr sigHdl, uint64_t idx) {
+    return (sigHdl->group != nullptr || sigHdl->stored || sigHdl->periodic) && idx >= sigHdl->knownFromIdx;
+}
+
+inline static uint32_t twoStateValueAt(SignalHandlePtr sigHdl, uint64_t idx) {
+    if(sigHdl->group != nullptr) {
+        return sigHdl->group->get(idx, sigHdl->groupSlot);
+    } else if(sigHdl->stored) {
+        return sigHdl->valueStore.get(idx);
+    }
+    return sigHdl->periodicClock.valueAt(timeTable[idx]);
+}
+
+#ifdef USE_FSDB
+// Index at which a value change at `changeTime` becomes visible(see `extractChangeList()`), UINT64_MAX if it is after the last index. `hint` is an index close to the result.
+inline static uint64_t fsdbVisibleIndex(uint64_t changeTime, uint64_t hint) {
+    auto visibleTime = changeTime == 0 ? 0 : changeTime - 1;
+    auto index = timeTable.findIndex(visibleTime, hint);
+    if(timeTable[index] < visibleTime) {
+        if(index == cursor.maxIndex) {
+            return UINT64_MAX;
+        }
+        index++;
+    }
+    return index;
+}
+#endif
+
+// Walk the values of `sigHdl` in [startIdx, endIdx) from the wave file: `onValue(index, vecvals)` gets the value at `startIdx` first and then every change after it, until it returns false.
+// A change may be reported more than once for the same index(e.g. glitches in FSDB), the last one wins.
+template <typename F>
+static void walkWaveRange(SignalHandlePtr sigHdl, uint64_t startIdx, uint64_t endIdx, F &&onValue) {
+#ifdef USE_FSDB
+    auto vcTrvsHdl = sigHdl->vcTrvsHdl;
+    auto vecvals = sigHdl->vecvalBuffer.data();
+    auto &kernels = bitConvert();
+    byte_T *retVC;
+
+    auto decode = [&]() {
+        if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGetVC(&retVC)) [[unlikely]] {
+            PANIC("vcTrvsHdl->ffrGetVC() failed!", sigHdl->name);
+        }
+        if(vcTrvsHdl->ffrGetBytesPerBit() != FSDB_BYTES_PER_BIT_1B) [[unlikely]] {
+            PANIC("TODO: FSDB_BYTES_PER_BIT_4B/8B", sigHdl->name);
+        }
+        kernels.packFourState(retVC, sigHdl->bitSize, reinterpret_cast<uint32_t *>(vecvals));
+    };
+
+    // Same position as `vpi_get_value` at `startIdx`
+    auto time = UInt64ToXtag(timeTable[startIdx]);
+    time.hltag.L = time.hltag.L + 1;
+    if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGotoXTag(&time)) [[unlikely]] {
+        PANIC("vcTrvsHdl->ffrGotoXTag() failed!", sigHdl->name, startIdx);
+    }
+    decode();
+    if(!onValue(startIdx, vecvals)) {
+        return;
+    }
+
+    fsdbXTag xtag;
+    uint64_t index = startIdx;
+    while(FSDB_RC_SUCCESS == vcTrvsHdl->ffrGotoNextVC()) {
+        vcTrvsHdl->ffrGetXTag((void *)&xtag);
+        index = fsdbVisibleIndex(Xtag64ToUInt64(xtag.hltag), index);
+        if(index == UINT64_MAX || index >= endIdx) {
+            break;
+        }
+        decode();
+        if(!onValue(index, vecvals)) {
+            break;
+        }
+    }
+#else
+    using Callback = std::remove_reference_t<F>;
+    wellen_vpi_iter_vector_range(sigHdl->wellenHdl, startIdx, endIdx, vecvalWordCnt(sigHdl), &onValue, [](void *context, uint64_t index, const s_vpi_vecval *vecvals) {
+        return (*reinterpret_cast<Callback *>(context))(index, vecvals);
+    });
+#endif
+}
+
+// Walk the changes of `sigHdl` at or before `fromIdx` from the wave file, latest first: `onValue(index, vecvals)` gets the index of each change and the value after it, until it returns false.
+// The value before the first change is not reported. As in `walkWaveRange()` an index may be reported more than once, here the first one wins.
+template <typename F>
+static void walkWaveRangeBackward(SignalHandlePtr sigHdl, uint64_t fromIdx, F &&onValue) {
+#ifdef USE_FSDB
+    auto vcTrvsHdl = sigHdl->vcTrvsHdl;
+    auto vecvals = sigHdl->vecvalBuffer.data();
+    auto &kernels = bitConvert();
+    byte_T *retVC;
+
+    // Same position as `vpi_get_value` at `fromIdx`, i.e. the last change visible at `fromIdx`
+    auto time = UInt64ToXtag(timeTable[fromIdx]);
+    time.hltag.L = time.hltag.L + 1;
+    if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGotoXTag(&time)) [[unlikely]] {
+        PANIC("vcTrvsHdl->ffrGotoXTag() failed!", sigHdl->name, fromIdx);
+    }
+
+    fsdbXTag xtag;
+    uint64_t index = fromIdx;
+    do {
+        vcTrvsHdl->ffrGetXTag((void *)&xtag);
+        index = std::min(fsdbVisibleIndex(Xtag64ToUInt64(xtag.hltag), index), fromIdx);
+        if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGetVC(&retVC)) [[unlikely]] {
+            PANIC("vcTrvsHdl->ffrGetVC() failed!", sigHdl->name);
         }
-        case vpiBinStrVal: {
-            auto &bitSize = fsdbSigHdl->bitSize;
-            auto value = fsdbSigHdl->optValueVec[cursor.index];
-            for (int i = 0; i < bitSize; i++) {
-                buffer[bitSize - 1 - i] = (value & (1 << i)) ? '1' : '0';
+        if(vcTrvsHdl->ffrGetBytesPerBit() != FSDB_BYTES_PER_BIT_1B) [[unlikely]] {
+            PANIC("TODO: FSDB_BYTES_PER_BIT_4B/8B", sigHdl->name);
+        }
+        kernels.packFourState(retVC, sigHdl->bitSize, reinterpret_cast<uint32_t *>(vecvals));
+        if(!onValue(index, vecvals)) {
+            break;
+        }
+    } while(FSDB_RC_SUCCESS == vcTrvsHdl->ffrGotoPrevVC());
+#else
+    using Callback = std::remove_reference_t<F>;
+    wellen_vpi_iter_vector_range_rev(sigHdl->wellenHdl, fromIdx, vecvalWordCnt(sigHdl), &onValue, [](void *context, uint64_t index, const s_vpi_vecval *vecvals) {
+        return (*reinterpret_cast<Callback *>(context))(index, vecvals);
+    });
+#endif
+}
+
+// Sample `handle` at `startIdx`, `startIdx + stride`, ... below `endIdx` and write the values back to back into `out`, each one in the `vpiVectorVal` layout with `max(1, (bitSize + 31) / 32)` words. Returns the number of samples.
+// Offline scans should use this instead of moving the cursor and calling `vpi_get_value` at every index: the wave file is walked once over the range and every change is decoded only once, the samples in between are plain copies.
+extern "C" uint64_t wave_vpi_get_values(vpiHandle handle, uint64_t startIdx, uint64_t endIdx, uint64_t stride, s_vpi_vecval *out) {
+    ASSERT(stride != 0);
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+    endIdx = std::min<uint64_t>(endIdx, timeTable.size());
+    if(startIdx >= endIdx) {
+        return 0;
+    }
+    auto sampleCnt = (endIdx - startIdx + stride - 1) / stride;
+
+    if(hasTwoStateValue(sigHdl, startIdx)) {
+        for(uint64_t i = 0; i < sampleCnt; i++) {
+            out[i] = s_vpi_vecval{.aval = static_cast<PLI_INT32>(twoStateValueAt(sigHdl, startIdx + i * stride)), .bval = 0};
+        }
+        return sampleCnt;
+    }
+
+    auto wordCnt = vecvalWordCnt(sigHdl);
+    std::vector<s_vpi_vecval> value(wordCnt);
+    uint64_t nextIdx = startIdx;
+    auto fill = [&](uint64_t untilIdx) {
+        for(; nextIdx < untilIdx; nextIdx += stride) {
+            out = std::copy_n(value.data(), wordCnt, out);
+        }
+    };
+    walkWaveRange(sigHdl, startIdx, endIdx, [&](uint64_t index, const s_vpi_vecval *vecvals) {
+        fill(index);
+        std::copy_n(vecvals, wordCnt, value.data());
+        return true;
+    });
+    fill(endIdx);
+    return sampleCnt;
+}
+
+// Change-list variant of `wave_vpi_get_values`: write the value of `handle` at `startIdx` and then every change below `endIdx` as (index, value) pairs into `indices`/`values`, at most `maxChanges` of them. Returns the number of pairs.
+// If it returns `maxChanges`, the scan can be continued from the last index plus one.
+extern "C" uint64_t wave_vpi_get_changes(vpiHandle handle, uint64_t startIdx, uint64_t endIdx, uint64_t *indices, s_vpi_vecval *values, uint64_t maxChanges) {
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+    endIdx = std::min<uint64_t>(endIdx, timeTable.size());
+    uint64_t cnt = 0;
+    if(startIdx >= endIdx || maxChanges == 0) {
+        return 0;
+    }
+
+    if(hasTwoStateValue(sigHdl, startIdx)) {
+        for(auto idx = startIdx; idx < endIdx && cnt < maxChanges; idx = findNextEdge(handle, idx, SignalEdge::Any)) {
+            indices[cnt] = idx;
+            values[cnt] = s_vpi_vecval{.aval = static_cast<PLI_INT32>(twoStateValueAt(sigHdl, idx)), .bval = 0};
+            cnt++;
+        }
+        return cnt;
+    }
+
+    auto wordCnt = vecvalWordCnt(sigHdl);
+    auto sameValue = [&](uint64_t i, const s_vpi_vecval *vecvals) { return std::memcmp(values + i * wordCnt, vecvals, wordCnt * sizeof(s_vpi_vecval)) == 0; };
+    walkWaveRange(sigHdl, startIdx, endIdx, [&](uint64_t index, const s_vpi_vecval *vecvals) {
+        if(cnt != 0 && indices[cnt - 1] == index) {
+            // Same index again, keep the last value and drop the pair if it turns out to be no change at all
+            std::copy_n(vecvals, wordCnt, values + (cnt - 1) * wordCnt);
+            if(cnt >= 2 && sameValue(cnt - 2, vecvals)) {
+                cnt--;
             }
-            buffer[bitSize] = '\0';
-            value_p->value.str = (char *)buffer;
-            return;
+            return true;
         }
-        default:
-            PANIC("Unsupported!", value_p->format);
+        if(cnt != 0 && sameValue(cnt - 1, vecvals)) {
+            return true;
         }
-    } else {
-        fsdbSigHdl->readCnt++;
+        if(cnt == maxChanges) {
+            return false;
+        }
+        indices[cnt] = index;
+        std::copy_n(vecvals, wordCnt, values + cnt * wordCnt);
+        cnt++;
+        return true;
+    });
+    return cnt;
+}
 
-        // Doing somthing like JIT(Just-In-Time)...
-        if(!fsdbSigHdl->doOpt && fsdbSigHdl->bitSize <= 32 && fsdbSigHdl->readCnt > jitHotAccessThreshold) {
-            auto _jitOptThreadCnt = jitOptThreadCnt.load();
-            if(_jitOptThreadCnt <= jitMaxOptThreads) {
-                jitOptThreadCnt.store(_jitOptThreadCnt + 1);
-                fsdbSigHdl->doOpt = true;
-                fsdbSigHdl->continueOpt = false;
-                fsdbSigHdl->optThread = std::thread(std::bind(optThreadTask, fsdbWaveVpi->waveFileName, fsdbWaveVpi->xtagVec, fsdbSigHdl));
+// First index after `fromIdx` at which `pred(prev, value)` holds for a change of `handle`, where `prev`/`value` are the values before and after the change in the `vpiVectorVal` layout. UINT64_MAX if there is none.
+// Stored, grouped and periodic signals jump from edge to edge of their storage, other signals walk the changes of the wave file from `fromIdx` on and never decode the indices in between.
+template <typename Pred>
+static uint64_t findNextChange(vpiHandle handle, uint64_t fromIdx, Pred &&pred) {
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+    if(fromIdx >= cursor.maxIndex) {
+        return UINT64_MAX;
+    }
+
+    if(hasTwoStateValue(sigHdl, fromIdx)) {
+        s_vpi_vecval prev{.aval = static_cast<PLI_INT32>(twoStateValueAt(sigHdl, fromIdx)), .bval = 0};
+        for(auto idx = findNextEdge(handle, fromIdx, SignalEdge::Any); idx != UINT64_MAX; idx = findNextEdge(handle, idx, SignalEdge::Any)) {
+            s_vpi_vecval value{.aval = static_cast<PLI_INT32>(twoStateValueAt(sigHdl, idx)), .bval = 0};
+            if(pred(&prev, &value)) {
+                return idx;
             }
+            prev = value;
         }
+        return UINT64_MAX;
     }
 
-ReadFromFSDB:
+    // The value of an index is only known once the walk has moved past it, see `walkWaveRange()`
+    auto wordCnt = vecvalWordCnt(sigHdl);
+    std::vector<s_vpi_vecval> prev(wordCnt), pending(wordCnt);
+    uint64_t pendingIdx = UINT64_MAX, found = UINT64_MAX;
+    auto settle = [&]() {
+        if(pendingIdx != fromIdx && pred(prev.data(), pending.data())) {
+            found = pendingIdx;
+            return true;
+        }
+        std::swap(prev, pending);
+        return false;
+    };
+    walkWaveRange(sigHdl, fromIdx, timeTable.size(), [&](uint64_t index, const s_vpi_vecval *vecvals) {
+        if(pendingIdx != UINT64_MAX && index != pendingIdx && settle()) {
+            return false;
+        }
+        pendingIdx = index;
+        std::copy_n(vecvals, wordCnt, pending.data());
+        return true;
+    });
+    if(found == UINT64_MAX && pendingIdx != UINT64_MAX) {
+        settle();
+    }
+    return found;
+}
 
-    auto vcTrvsHdl = fsdbSigHdl->vcTrvsHdl;
-    byte_T *retVC;
-    fsdbBytesPerBit bpb;
-    size_t bitSize = fsdbSigHdl->bitSize;
+// Backward counterpart of `findNextChange()`: last index at or before `fromIdx` at which `pred(prev, value)` holds for a change of `handle`, UINT64_MAX if there is none.
+template <typename Pred>
+static uint64_t findPrevChange(vpiHandle handle, uint64_t fromIdx, Pred &&pred) {
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+    fromIdx = std::min<uint64_t>(fromIdx, cursor.maxIndex);
+
+    // The storage has to cover the whole history, a JIT store only knows the indices from `knownFromIdx` on
+    if(hasTwoStateValue(sigHdl, 0)) {
+        for(auto idx = findPrevEdge(handle, fromIdx, SignalEdge::Any); idx != UINT64_MAX && idx != 0; idx = findPrevEdge(handle, idx - 1, SignalEdge::Any)) {
+            s_vpi_vecval prev{.aval = static_cast<PLI_INT32>(twoStateValueAt(sigHdl, idx - 1)), .bval = 0};
+            s_vpi_vecval value{.aval = static_cast<PLI_INT32>(twoStateValueAt(sigHdl, idx)), .bval = 0};
+            if(pred(&prev, &value)) {
+                return idx;
+            }
+        }
+        return UINT64_MAX;
+    }
 
-    auto time = fsdbWaveVpi->xtagVec[cursor.index];
-    time.hltag.L = time.hltag.L + 1; // Move a little bit further to ensure we are not in the sensitive clock edge which may lead to signal value confusion.
-    
-    if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGotoXTag(&time)) [[unlikely]] {
-        auto currIndexTime = fsdbWaveVpi->xtagU64Vec[cursor.index];
-        auto maxIndexTime = fsdbWaveVpi->xtagU64Vec[cursor.maxIndex];
-        PANIC("vcTrvsHdl->ffrGotoXTag() failed!", time.hltag.L, time.hltag.H, maxIndexTime, currIndexTime, cursor.maxIndex, cursor.index);
+    auto wordCnt = vecvalWordCnt(sigHdl);
+    std::vector<s_vpi_vecval> later(wordCnt);
+    uint64_t laterIdx = UINT64_MAX, found = UINT64_MAX;
+    walkWaveRangeBackward(sigHdl, fromIdx, [&](uint64_t index, const s_vpi_vecval *vecvals) {
+        if(index == laterIdx) {
+            return true;
+        }
+        if(laterIdx != UINT64_MAX && pred(vecvals, later.data())) {
+            found = laterIdx;
+            return false;
+        }
+        laterIdx = index;
+        std::copy_n(vecvals, wordCnt, later.data());
+        return true;
+    });
+
+    // The value before the first change of the wave file is 0
+    if(found == UINT64_MAX && laterIdx != UINT64_MAX && laterIdx != 0) {
+        std::vector<s_vpi_vecval> first(wordCnt);
+        if(pred(first.data(), later.data())) {
+            found = laterIdx;
+        }
+    }
+    return found;
+}
+
+// Index of the first change of `handle` after `fromIdx`, UINT64_MAX if it does not change any more. Together with `wave_vpi_prev_change` this lets scripts and the scheduler jump to the next event of interest instead of stepping through every index.
+extern "C" uint64_t wave_vpi_next_change(vpiHandle handle, uint64_t fromIdx) {
+    auto wordCnt = vecvalWordCnt(reinterpret_cast<SignalHandlePtr>(handle));
+    return findNextChange(handle, fromIdx, [wordCnt](const s_vpi_vecval *prev, const s_vpi_vecval *value) { return std::memcmp(prev, value, wordCnt * sizeof(s_vpi_vecval)) != 0; });
+}
+
+// Index of the last change of `handle` at or before `fromIdx`, UINT64_MAX if it has not changed yet.
+extern "C" uint64_t wave_vpi_prev_change(vpiHandle handle, uint64_t fromIdx) {
+    auto wordCnt = vecvalWordCnt(reinterpret_cast<SignalHandlePtr>(handle));
+    return findPrevChange(handle, fromIdx, [wordCnt](const s_vpi_vecval *prev, const s_vpi_vecval *value) { return std::memcmp(prev, value, wordCnt * sizeof(s_vpi_vecval)) != 0; });
+}
+
+// First index after `fromIdx` at which `handle` becomes `value`(no X/Z bits, wider signals must be zero above the low 64 bits), UINT64_MAX if there is none.
+extern "C" uint64_t wave_vpi_next_value(vpiHandle handle, uint64_t fromIdx, uint64_t value) {
+    auto wordCnt = vecvalWordCnt(reinterpret_cast<SignalHandlePtr>(handle));
+    if(wordCnt < 2 && (value >> 32) != 0) {
+        return UINT64_MAX;
+    }
+    auto equals = [wordCnt, value](const s_vpi_vecval *vecvals) {
+        for(size_t i = 0; i < wordCnt; i++) {
+            auto word = i < 2 ? static_cast<uint32_t>(value >> (i * 32)) : 0;
+            if(static_cast<uint32_t>(vecvals[i].aval) != word || vecvals[i].bval != 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+    return findNextChange(handle, fromIdx, [&equals](const s_vpi_vecval *prev, const s_vpi_vecval *cur) { return equals(cur) && !equals(prev); });
+}
+
+// First index after `fromIdx` at which bit `bit` of `handle` has an `edge`(a `SignalEdge`, see `wave_vpi_get_value_edges`), UINT64_MAX if there is none. X/Z bits count as 0.
+extern "C" uint64_t wave_vpi_next_bit_edge(vpiHandle handle, uint64_t fromIdx, uint32_t bit, uint32_t edge) {
+    ASSERT(edge <= static_cast<uint32_t>(SignalEdge::Any), "Unknown edge", edge);
+    ASSERT(bit < reinterpret_cast<SignalHandlePtr>(handle)->bitSize, "Bit out of range", bit);
+    auto bitOf = [bit](const s_vpi_vecval *vecvals) {
+        auto &word = vecvals[bit / 32];
+        return (static_cast<uint32_t>(word.aval & ~word.bval) >> (bit % 32)) & 1;
+    };
+    return findNextChange(handle, fromIdx, [&](const s_vpi_vecval *prev, const s_vpi_vecval *value) { return isEdge(bitOf(prev), bitOf(value), static_cast<SignalEdge>(edge)); });
+}
+
+inline static bool seekTermMatches(const WaveSeekNode &term, const s_vpi_vecval *vecvals, size_t wordCnt) {
+    uint64_t aval = static_cast<uint32_t>(vecvals[0].aval);
+    uint64_t bval = static_cast<uint32_t>(vecvals[0].bval);
+    if(wordCnt > 1) {
+        aval |= static_cast<uint64_t>(static_cast<uint32_t>(vecvals[1].aval)) << 32;
+        bval |= static_cast<uint64_t>(static_cast<uint32_t>(vecvals[1].bval)) << 32;
+    }
+    return (bval & term.mask) == 0 && (aval & term.mask) == (term.value & term.mask);
+}
+
+// Whether node `n` of a seek condition holds at `idx`. If not, `next` is the first index after `idx` at which it may hold(UINT64_MAX if never): the first match of a term, the latest of the children of an And, the earliest of the children of an Or.
+// The search only moves forward, so `falseUntil[n]` keeps the first match of term `n` and the term is not read again before the search gets there.
+static bool evalSeekNode(const WaveSeekNode *nodes, uint32_t n, uint64_t idx, std::vector<uint64_t> &falseUntil, uint64_t &next) {
+    auto &node = nodes[n];
+    if(node.op == waveSeekTerm) {
+        if(idx < falseUntil[n]) {
+            next = falseUntil[n];
+            return false;
+        }
+        auto wordCnt = vecvalWordCnt(reinterpret_cast<SignalHandlePtr>(node.handle));
+        std::vector<s_vpi_vecval> vecvals(wordCnt);
+        wave_vpi_get_values(node.handle, idx, idx + 1, 1, vecvals.data());
+        if(seekTermMatches(node, vecvals.data(), wordCnt)) {
+            return true;
+        }
+        next = falseUntil[n] = findNextChange(node.handle, idx, [&](const s_vpi_vecval *prev, const s_vpi_vecval *value) { return seekTermMatches(node, value, wordCnt); });
+        return false;
+    }
+
+    auto isAnd = node.op == waveSeekAnd;
+    next = isAnd ? idx : UINT64_MAX;
+    for(uint32_t c = node.first; c < node.first + node.count; c++) {
+        uint64_t childNext;
+        if(evalSeekNode(nodes, c, idx, falseUntil, childNext)) {
+            if(!isAnd) {
+                return true;
+            }
+        } else if(isAnd) {
+            next = std::max(next, childNext);
+            if(next == UINT64_MAX) {
+                return false;
+            }
+        } else {
+            next = std::min(next, childNext);
+        }
+    }
+    return isAnd && next == idx;
+}
+
+// Move the cursor forward to the first index at or after `cursor.index` at which the condition `nodes[0]` holds, without running any callback for the indices in between. `skippedTime`(if not null) gets the simulation time skipped over.
+// Returns false and leaves the cursor where it is if the condition does not hold before the end of the replay window. Instead of evaluating every index, the search jumps from one possible match to the next by walking the change lists of the terms, see `evalSeekNode()`.
+// Called from a callback, the current step finishes at the new index and the main loop runs the next step there, then the time callbacks that were due in between fire at once.
+extern "C" bool wave_vpi_seek(const WaveSeekNode *nodes, uint32_t nodeCnt, uint64_t *skippedTime) {
+    ASSERT(nodeCnt != 0);
+    for(uint32_t n = 0; n < nodeCnt; n++) {
+        ASSERT(nodes[n].op == waveSeekTerm || nodes[n].op == waveSeekAnd || nodes[n].op == waveSeekOr, "Unknown seek node", n, nodes[n].op);
+        if(nodes[n].op == waveSeekTerm) {
+            ASSERT(nodes[n].handle != nullptr, "Seek term without handle", n);
+        } else {
+            ASSERT(nodes[n].first > n && nodes[n].first + nodes[n].count <= nodeCnt, "Seek node children must come after their parent", n, nodes[n].first, nodes[n].count);
+        }
+    }
+    if(skippedTime != nullptr) {
+        *skippedTime = 0;
+    }
+
+    // The search stays inside the replay window, see `wave_vpi_set_window`
+    auto lastIdx = std::min(cursor.maxIndex, replayEndIdx);
+    std::vector<uint64_t> falseUntil(nodeCnt, 0);
+    uint64_t idx = cursor.index, next;
+    while(!evalSeekNode(nodes, 0, idx, falseUntil, next)) {
+        if(next == UINT64_MAX || next > lastIdx) {
+            return false;
+        }
+        idx = next;
+    }
+
+    // With WAVE_VPI_STEP_CLOCK the main loop only visits `stepIndices`, stop at the first step at or after the match
+    if(!stepIndices.empty() && idx != cursor.index) {
+        auto it = std::lower_bound(stepIndices.begin(), stepIndices.end(), idx);
+        if(it == stepIndices.end() || *it > lastIdx) {
+            return false;
+        }
+        idx = *it;
+    }
+
+    auto startIdx = cursor.index;
+    auto startTime = timeTable[startIdx];
+    if(idx != startIdx) {
+        cursor.updateIndex(idx);
+        cursorSeeked = true;
+#ifdef USE_FSDB
+        if(fsdbStreamer.enable) {
+            fsdbStreamer.seek(idx);
+        }
+#endif
+    }
+    auto skipped = timeTable[idx] - startTime;
+    fmt::println("[wave_vpi] seek: cursor.index {} => {}, skipped time => {}", startIdx, idx, skipped);
+    if(skippedTime != nullptr) {
+        *skippedTime = skipped;
+    }
+    return true;
+}
+
+#ifdef USE_FSDB
+// Every read cursor reads through its own fsdb object so that it never shares a traverse state with the main loop. FsdbReader does not allow multiple ffrObjects to be processed at multiple threads either(see `optThreadTask()`), so the wave reads of the read cursors still take turns.
+std::mutex readCursorFsdbMutex;
+#endif
+
+// Refresh `span` of `readCursor` to the value of `sigHdl` at `index`.
+static void readCursorSpan(WaveReadCursor *readCursor, SignalHandlePtr sigHdl, CursorSpan &span, uint64_t index) {
+    // A periodic clock is immutable once it is detected, unlike value stores and groups which may be rebuilt by the main loop
+    if(sigHdl->periodic && index >= sigHdl->knownFromIdx) {
+        auto time = timeTable[index];
+        auto nextTime = sigHdl->periodicClock.nextEdgeTime(time, SignalEdge::Any);
+        span.vecvals[0] = s_vpi_vecval{.aval = static_cast<PLI_INT32>(sigHdl->periodicClock.valueAt(time)), .bval = 0};
+        span.startIdx = index;
+        span.endIdx = nextTime == UINT64_MAX ? UINT64_MAX : std::max(timeTable.findIndex(nextTime, index), index + 1);
+        return;
+    }
+
+#ifdef USE_FSDB
+    std::lock_guard<std::mutex> lock(readCursorFsdbMutex);
+    if(readCursor->fsdbObj == nullptr) {
+        readCursor->fsdbObj = ffrObject::ffrOpenNonSharedObj(const_cast<char *>(waveFilePath.c_str()));
+        ASSERT(readCursor->fsdbObj != nullptr, "Failed to open fsdb file for a read cursor", waveFilePath);
+        readCursor->fsdbObj->ffrReadScopeVarTree();
+    }
+    if(span.vcTrvsHdl == nullptr) {
+        span.vcTrvsHdl = readCursor->fsdbObj->ffrCreateVCTrvsHdl(sigHdl->varIdCode);
+        ASSERT(span.vcTrvsHdl != nullptr, sigHdl->name);
+    }
+    auto vcTrvsHdl = span.vcTrvsHdl;
+    auto time = UInt64ToXtag(timeTable[index]);
+    time.hltag.L = time.hltag.L + 1; // Same position as `vpi_get_value`
+    byte_T *retVC;
+    if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGotoXTag(&time) || FSDB_RC_SUCCESS != vcTrvsHdl->ffrGetVC(&retVC)) [[unlikely]] {
+        PANIC("Failed to read signal with a read cursor", sigHdl->name, index);
     }
-    if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGetVC(&retVC)) [[unlikely]] {
-        PANIC("vcTrvsHdl->ffrGetVC() failed!");
+    if(vcTrvsHdl->ffrGetBytesPerBit() != FSDB_BYTES_PER_BIT_1B) [[unlikely]] {
+        PANIC("TODO: FSDB_BYTES_PER_BIT_4B/8B", sigHdl->name);
     }
+    bitConvert().packFourState(retVC, sigHdl->bitSize, reinterpret_cast<uint32_t *>(span.vecvals.data()));
+
+    fsdbXTag xtag;
+    vcTrvsHdl->ffrGetXTag((void *)&xtag);
+    span.startIdx = std::min(fsdbVisibleIndex(Xtag64ToUInt64(xtag.hltag), index), index);
+    span.endIdx = UINT64_MAX;
+    if(FSDB_RC_SUCCESS == vcTrvsHdl->ffrGotoNextVC()) {
+        vcTrvsHdl->ffrGetXTag((void *)&xtag);
+        span.endIdx = std::max(fsdbVisibleIndex(Xtag64ToUInt64(xtag.hltag), index), index + 1);
+    }
+#else
+    uint64_t range[2];
+    wellen_vpi_get_vector_span(sigHdl->wellenHdl, index, span.vecvals.data(), span.vecvals.size(), range);
+    span.startIdx = range[0];
+    span.endIdx = range[1];
+#endif
+}
 
-    bpb = vcTrvsHdl->ffrGetBytesPerBit();
+// Create a read cursor at index 0. A read cursor reads the loaded wave at its own index, without moving `cursor` and without touching the state that the main loop keeps for each signal(stream values, JIT value stores, value groups and output buffers).
+// Every read cursor keeps the last value of each signal it reads along with the indices over which it holds, a cursor that moves forward only goes back to the wave when a signal changes. This lets a script compare two points in time(e.g. a request and its response) or run several passes without moving `cursor` back and forth.
+// Different read cursors may be used from different threads at once, one read cursor is used by one thread at a time. All the handles have to be created with `vpi_handle_by_name` before the threads start reading.
+extern "C" WaveReadCursor *wave_vpi_cursor_create() { return new WaveReadCursor(); }
 
-    switch (value_p->format) {
-    case vpiIntVal: {
-        value_p->value.integer = 0;
-        switch (bpb) {
-        [[likely]] case FSDB_BYTES_PER_BIT_1B: {
-            for (int i = 0; i < bitSize; i++) {
-                switch (retVC[i]) {
-                case FSDB_BT_VCD_0:
-                    break;
-                case FSDB_BT_VCD_1:
-                    value_p->value.integer += 1 << (bitSize - i - 1);
-                    break;
-                case FSDB_BT_VCD_X:
-                    // treat `X` as `0`
-                    break;
-                case FSDB_BT_VCD_Z:
-                    // treat `Z` as `0`
-                    break;
-                default:
-                    PANIC("unknown verilog bit type found.");
-                }
-            }
-            break;
-        }
-        case FSDB_BYTES_PER_BIT_4B:
-            PANIC("TODO: FSDB_BYTES_PER_BIT_4B");
-            break;
-        case FSDB_BYTES_PER_BIT_8B:
-            PANIC("TODO: FSDB_BYTES_PER_BIT_8B");
-            break;
-        default:
-            PANIC("Should not reach here!");
+extern "C" void wave_vpi_cursor_free(WaveReadCursor *readCursor) {
+#ifdef USE_FSDB
+    std::lock_guard<std::mutex> lock(readCursorFsdbMutex);
+    for(auto &[sigHdl, span] : readCursor->spans) {
+        if(span.vcTrvsHdl != nullptr) {
+            span.vcTrvsHdl->ffrFree();
         }
-        break;
     }
-    case vpiVectorVal: {
-        switch (bpb) {
-        [[likely]] case FSDB_BYTES_PER_BIT_1B: {
-            uint32_t chunkSize = 0;
-            if ((bitSize % 32) == 0) {
-                chunkSize = bitSize / 32;
-            } else {
-                chunkSize = bitSize / 32 + 1;
-            }
+    if(readCursor->fsdbObj != nullptr) {
+        readCursor->fsdbObj->ffrClose();
+    }
+#endif
+    delete readCursor;
+}
 
-            uint32_t tmpVal    = 0;
-            uint32_t bufferIdx = 0;
-            uint32_t tmpIdx    = 0;
-            for (int i = bitSize - 1; i >= 0; i--) {
-                switch (retVC[i]) {
-                case FSDB_BT_VCD_0:
-                    break;
-                case FSDB_BT_VCD_1:
-                    tmpVal += 1 << tmpIdx;
-                    break;
-                case FSDB_BT_VCD_X:
-                    // treat `X` as `0`
-                    break;
-                case FSDB_BT_VCD_Z:
-                    // treat `Z` as `0`
-                    break;
-                default:
-                    PANIC("unknown verilog bit type found.", i);
-                }
-                tmpIdx++;
-                if (tmpIdx == 32) {
-                    vpiValueVecs[bufferIdx].aval = tmpVal;
-                    vpiValueVecs[bufferIdx].bval = 0;
-                    tmpVal                                       = 0;
-                    tmpIdx                                       = 0;
-                    bufferIdx++;
-                }
-            }
+extern "C" void wave_vpi_cursor_set_index(WaveReadCursor *readCursor, uint64_t index) {
+    ASSERT(index < timeTable.size(), "Index out of the time table", index);
+    readCursor->index = index;
+}
 
-            if (tmpIdx != 0) {
-                vpiValueVecs[bufferIdx].aval = tmpVal;
-                vpiValueVecs[bufferIdx].bval = 0;
-            }
-            break;
-        }
-        case FSDB_BYTES_PER_BIT_4B:
-            PANIC("TODO: FSDB_BYTES_PER_BIT_4B");
-            break;
-        case FSDB_BYTES_PER_BIT_8B:
-            PANIC("TODO: FSDB_BYTES_PER_BIT_8B");
-            break;
-        default:
-            PANIC("Should not reach here!");
-        }
-        value_p->value.vector = vpiValueVecs;
-        break;
-    }
-    case vpiHexStrVal: {
-        static const char hexLookUpTable[] = {'0', '1', '2', '3', '4', '4', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
-        switch (bpb) {
-        [[likely]] case FSDB_BYTES_PER_BIT_1B: {
-            int bufferIdx = 0;
-            int tmpVal    = 0;
-            int tmpIdx    = 0;
-            int chunkSize = 0;
-            if ((bitSize % 4) == 0) {
-                chunkSize = bitSize / 4;
-            } else {
-                chunkSize = bitSize / 4 + 1;
-            }
-            
-            for (int i = bitSize - 1; i >= 0; i--) {
-                switch (retVC[i]) {
-                case FSDB_BT_VCD_0:
-                    break;
-                case FSDB_BT_VCD_1:
-                    tmpVal += 1 << tmpIdx;
-                    break;
-                case FSDB_BT_VCD_X:
-                    // treat `X` as `0`
-                    break;
-                case FSDB_BT_VCD_Z:
-                    // treat `Z` as `0`
-                    break;
-                default:
-                    PANIC("unknown verilog bit type found.", i);
-                }
-                tmpIdx++;
-                if (tmpIdx == 4) {
-                    buffer[chunkSize - 1 - bufferIdx] = hexLookUpTable[tmpVal];
-                    tmpVal                            = 0;
-                    tmpIdx                            = 0;
-                    bufferIdx++;
-                }
-            }
-            if (tmpIdx != 0) {
-                buffer[chunkSize - 1 - bufferIdx] = hexLookUpTable[tmpVal];
-                bufferIdx++;
-            }
-            buffer[bufferIdx] = '\0';
+// Move `readCursor` to the last index at or before `time`.
+extern "C" void wave_vpi_cursor_set_time(WaveReadCursor *readCursor, uint64_t time) { readCursor->index = timeTable.findIndex(time, readCursor->index); }
+
+extern "C" uint64_t wave_vpi_cursor_get_index(const WaveReadCursor *readCursor) { return readCursor->index; }
+
+// Read `handle` at the index of `readCursor`, the formats are vpiIntVal, vpiVectorVal, vpiHexStrVal and vpiBinStrVal. A returned vector or string belongs to `readCursor` and stays valid until its next read of the same signal.
+extern "C" void wave_vpi_cursor_get_value(WaveReadCursor *readCursor, vpiHandle handle, p_vpi_value value_p) {
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+    auto &span = readCursor->spans[sigHdl];
+    auto index = readCursor->index;
+    if(index < span.startIdx || index >= span.endIdx) {
+        span.vecvals.resize(vecvalWordCnt(sigHdl));
+        readCursorSpan(readCursor, sigHdl, span, index);
+    }
+
+    auto vecvals = span.vecvals.data();
+    switch(value_p->format) {
+        case vpiIntVal:
+            value_p->value.integer = vecvals[0].aval & ~vecvals[0].bval; // X and Z read as 0, same as `vpi_get_value`
             break;
-        }
-        case FSDB_BYTES_PER_BIT_4B:
-            PANIC("TODO: FSDB_BYTES_PER_BIT_4B");
+        case vpiVectorVal:
+            value_p->value.vector = vecvals;
             break;
-        case FSDB_BYTES_PER_BIT_8B:
-            PANIC("TODO: FSDB_BYTES_PER_BIT_8B");
+        case vpiHexStrVal:
+            span.str.resize((sigHdl->bitSize + 3) / 4 + 1);
+            fourStateWordsToHexStr(reinterpret_cast<const uint32_t *>(vecvals), sigHdl->bitSize, span.str.data());
+            value_p->value.str = span.str.data();
             break;
-        default:
-            PANIC("Should not reach here!");
-        }
-        value_p->value.str = (char *)buffer;
-        break;
-    }
-    [[unlikely]] case vpiBinStrVal: {
-        switch (bpb) {
-        [[likely]] case FSDB_BYTES_PER_BIT_1B: {
-            int i = 0;
-            for (i = 0; i < bitSize; i++) {
-                switch (retVC[i]) {
-                case FSDB_BT_VCD_0:
-                    buffer[i] = '0';
-                    break;
-                case FSDB_BT_VCD_1:
-                    buffer[i] = '1';
-                    break;
-                case FSDB_BT_VCD_X:
-                    // treat `X` as `0`
-                    buffer[i] = '0';
-                    break;
-                case FSDB_BT_VCD_Z:
-                    // treat `Z` as `0`
-                    buffer[i] = '0';
-                    break;
-                default:
-                    PANIC("unknown verilog bit type found.");
-                }
+        case vpiBinStrVal:
+            span.str.resize(sigHdl->bitSize + 1);
+            for(size_t i = 0; i < sigHdl->bitSize; i++) {
+                auto &word = vecvals[i / 32];
+                bool a = (word.aval >> (i % 32)) & 1, b = (word.bval >> (i % 32)) & 1;
+                span.str[sigHdl->bitSize - 1 - i] = b ? (a ? 'x' : 'z') : (a ? '1' : '0');
             }
-            buffer[i] = '\0';
-            break;
-        }
-        case FSDB_BYTES_PER_BIT_4B:
-            PANIC("TODO: FSDB_BYTES_PER_BIT_4B");
-            break;
-        case FSDB_BYTES_PER_BIT_8B:
-            PANIC("TODO: FSDB_BYTES_PER_BIT_8B");
+            span.str[sigHdl->bitSize] = '\0';
+            value_p->value.str = span.str.data();
             break;
         default:
-            PANIC("Should not reach here!");
+            ASSERT(false, "Unsupported format for a read cursor", value_p->format);
+    }
+}
+
+// Gather the values of the members of `bundle` at `cursor.index`.
+void gatherBundle(BundleHandle *bundle) {
+    auto &value = bundle->value;
+    if(value.index == cursor.index) {
+        return;
+    }
+    value.index = cursor.index;
+
+    bool changed = false;
+    s_vpi_value v{.format = vpiVectorVal};
+    for(size_t i = 0; i < bundle->members.size(); i++) {
+        vpi_get_value(reinterpret_cast<vpiHandle>(bundle->members[i]), &v);
+        auto dst = bundle->vecvals.data() + bundle->offsets[i];
+        auto bytes = (bundle->offsets[i + 1] - bundle->offsets[i]) * sizeof(s_vpi_vecval);
+        if(std::memcmp(dst, v.value.vector, bytes) != 0) {
+            std::memcpy(dst, v.value.vector, bytes);
+            changed = true;
         }
-        value_p->value.str = (char *)buffer;
-        break;
     }
-    default: {
-        PANIC("Unknown value format", value_p->format);
+    if(changed) {
+        value.seq++;
     }
+}
+
+// Create a bundle from existing signal handles, e.g. the fields of a valid/ready interface that a monitor reads at every step. `wave_vpi_bundle_get` gathers all the member values in one call, and a cbValueChange registered on the bundle fires once when any member changes.
+// The members are also put into one value group(if the value store is enabled and they fit), so that a gather reads neighbouring words instead of N separate storages.
+extern "C" vpiHandle wave_vpi_bundle_create(const vpiHandle *handles, size_t count, const char *name) {
+    ASSERT(handles != nullptr && count > 0);
+    auto bundle = std::make_unique<BundleHandle>();
+    bundle->name = name != nullptr ? std::string(name) : fmt::format("bundle_{}", bundleMap.size());
+
+    std::vector<vpiHandle> memberHandles;
+    bundle->offsets.emplace_back(0);
+    for(size_t i = 0; i < count; i++) {
+        ASSERT(handles[i] != nullptr, bundle->name, i);
+        ASSERT(bundleMap.find(handles[i]) == bundleMap.end(), "Nested bundles are not supported", bundle->name);
+        auto sigHdl = reinterpret_cast<SignalHandlePtr>(handles[i]);
+        bundle->members.emplace_back(sigHdl);
+        bundle->offsets.emplace_back(bundle->offsets.back() + vecvalWordCnt(sigHdl));
+        memberHandles.emplace_back(handles[i]);
     }
+    bundle->vecvals.assign(bundle->offsets.back(), s_vpi_vecval{.aval = 0, .bval = 0});
 
-    // auto format = std::string("");
-    // fmt::println("\n[{}] retVC:{}", hdlToNameMap[object], retVC[0]);
-    // if(value_p->format == vpiIntVal) {
-    //     format = "vpiIntVal";
-    //     fmt::println("[{}]@{} format:{} value: {}", hdlToNameMap[object], fsdbWaveVpi->xtagU64Vec[cursor.index], format, value_p->value.integer);
-    // } else if(value_p->format == vpiVectorVal) {
-    //     format = "vpiVectorVal";
-    //     fmt::println("[{}]@{} format:{} value: {}", hdlToNameMap[object], fsdbWaveVpi->xtagU64Vec[cursor.index], format, value_p->value.vector[0].aval);
-    // } else if (value_p->format == vpiHexStrVal) {
-    //     format = "vpiHexStrVal";
-    //     fmt::println("[{}]@{} format:{} value: {}", hdlToNameMap[object], fsdbWaveVpi->xtagU64Vec[cursor.index], format, value_p->value.str);
-    // }
-#else
-    wellen_vpi_get_value_from_index(reinterpret_cast<void *>(object), cursor.index, value_p);
-#endif
+    if(enableValueStore) {
+        buildValueGroup(memberHandles, bundle->name);
+    }
+
+    bundle->value = BundleValue{
+        .seq = 0,
+        .index = UINT64_MAX,
+        .memberCnt = static_cast<uint32_t>(count),
+        .wordCnt = bundle->offsets.back(),
+        .offsets = bundle->offsets.data(),
+        .vecvals = bundle->vecvals.data(),
+    };
+    gatherBundle(bundle.get());
+
+    auto handle = reinterpret_cast<vpiHandle>(bundle.get());
+    bundleMap[handle] = std::move(bundle);
+    return handle;
+}
+
+extern "C" const BundleValue *wave_vpi_bundle_get(vpiHandle handle) {
+    auto bundle = reinterpret_cast<BundleHandle *>(handle);
+    gatherBundle(bundle);
+    return &bundle->value;
 }
 
 PLI_BYTE8 *vpi_get_str(PLI_INT32 property, vpiHandle object) {
@@ -1069,7 +2518,7 @@ PLI_BYTE8 *vpi_get_str(PLI_INT32 property, vpiHandle object) {
         PANIC("Unimplemented property", property);
     }
 #else
-    return reinterpret_cast<PLI_BYTE8 *>(wellen_vpi_get_str(property, reinterpret_cast<void *>(object)));
+    return reinterpret_cast<PLI_BYTE8 *>(wellen_vpi_get_str(property, reinterpret_cast<WellenSignalHandlePtr>(object)->wellenHdl));
 #endif
 };
 
@@ -1082,7 +2531,7 @@ PLI_INT32 vpi_get(PLI_INT32 property, vpiHandle object) {
         PANIC("Unimplemented property", property);
     }
 #else
-    return wellen_vpi_get(property,reinterpret_cast<void *>(object));
+    return wellen_vpi_get(property, reinterpret_cast<WellenSignalHandlePtr>(object)->wellenHdl);
 #endif
 }
 
@@ -1113,6 +2562,25 @@ PLI_INT32 vpi_control(PLI_INT32 operation, ...) {
             }
             endOfSimulation();
             return 1;
+        case vpiWaveWindow: {
+            va_list args;
+            va_start(args, operation);
+            auto unit = va_arg(args, uint32_t);
+            auto start = va_arg(args, uint64_t);
+            auto end = va_arg(args, uint64_t);
+            va_end(args);
+            wave_vpi_set_window(unit, start, end);
+            return 1;
+        }
+        case vpiWaveSeek: {
+            va_list args;
+            va_start(args, operation);
+            auto nodes = va_arg(args, const WaveSeekNode *);
+            auto nodeCnt = va_arg(args, uint32_t);
+            auto skippedTime = va_arg(args, uint64_t *);
+            va_end(args);
+            return wave_vpi_seek(nodes, nodeCnt, skippedTime) ? 1 : 0;
+        }
         default:
             ASSERT(false, "Unsupported operation", operation);
             break;
@@ -1179,7 +2647,20 @@ inline uint32_t fsdbGetSingleBitValue(vpiHandle object) {
 #else
 inline std::string _wellen_get_value_str(vpiHandle object) {
     ASSERT(object != nullptr);
-    return std::string(wellen_get_value_str(reinterpret_cast<void *>(object), cursor.index));
+    auto wellenSigHdl = reinterpret_cast<WellenSignalHandlePtr>(object);
+    if(cursor.index < wellenSigHdl->knownFromIdx) [[unlikely]] {
+        // Fall through to wellen, which keeps `X`/`Z`
+    } else if(wellenSigHdl->group != nullptr || wellenSigHdl->stored) {
+        auto value = wellenSigHdl->group != nullptr ? wellenSigHdl->group->get(cursor.index, wellenSigHdl->groupSlot) : wellenSigHdl->valueStore.get(cursor.index);
+        std::string valueStr(wellenSigHdl->bitSize, '0');
+        for(size_t i = 0; i < wellenSigHdl->bitSize; i++) {
+            valueStr[wellenSigHdl->bitSize - 1 - i] = (value & (1U << i)) ? '1' : '0';
+        }
+        return valueStr;
+    } else if(wellenSigHdl->periodic) {
+        return wellenSigHdl->periodicClock.valueAt(timeTable[cursor.index]) ? "1" : "0";
+    }
+    return std::string(wellen_get_value_str(reinterpret_cast<WellenSignalHandlePtr>(object)->wellenHdl, cursor.index));
 }
 #endif
 
@@ -1196,12 +2677,32 @@ vpiHandle vpi_register_cb(p_cb_data cb_data_p) {
         case cbValueChange: {
             ASSERT(cb_data_p->obj != nullptr);
             ASSERT(cb_data_p->cb_rtn != nullptr);
+            if(auto it = bundleMap.find(cb_data_p->obj); it != bundleMap.end()) {
+                // The values of a bundle are read with `wave_vpi_bundle_get`, the callback carries no value
+                ASSERT(cb_data_p->value == nullptr || cb_data_p->value->format == vpiSuppressVal, it->second->name);
+                auto bundle = it->second.get();
+                for(auto sigHdl : bundle->members) {
+                    sigHdl->watched = true;
+                }
+                gatherBundle(bundle);
+                willAppendValueCb.emplace_back(std::make_pair(vpiHandleAllcator, ValueCbInfo{
+                    .cbData = std::make_shared<t_cb_data>(*cb_data_p),
+                    .handle = cb_data_p->obj,
+                    .bundle = bundle,
+                    .bundleSeq = bundle->value.seq,
+                }));
+                break;
+            }
             ASSERT(cb_data_p->time != nullptr && cb_data_p->time->type == vpiSuppressTime);
             ASSERT(cb_data_p->value != nullptr && cb_data_p->value->format == vpiIntVal);
             
             auto t = *cb_data_p;
+            reinterpret_cast<SignalHandlePtr>(cb_data_p->obj)->watched = true;
 #ifdef USE_FSDB
             size_t bitSize = reinterpret_cast<FsdbSignalHandlePtr>(cb_data_p->obj)->bitSize;
+            if(fsdbStreamer.enable) {
+                fsdbStreamer.addSignal(reinterpret_cast<FsdbSignalHandlePtr>(cb_data_p->obj));
+            }
             if(bitSize == 1) [[likely]] {
                 willAppendValueCb.emplace_back(std::make_pair(vpiHandleAllcator, ValueCbInfo{
                     .cbData = std::make_shared<t_cb_data>(*cb_data_p), 
@@ -1222,7 +2723,7 @@ vpiHandle vpi_register_cb(p_cb_data cb_data_p) {
 #else
             willAppendValueCb.emplace_back(std::make_pair(vpiHandleAllcator, ValueCbInfo{
                 .cbData = std::make_shared<t_cb_data>(*cb_data_p), 
-                .handle = *cb_data_p->obj,
+                .handle = cb_data_p->obj,
                 .valueStr = _wellen_get_value_str(cb_data_p->obj), 
             }));
 #endif
@@ -1232,13 +2733,8 @@ vpiHandle vpi_register_cb(p_cb_data cb_data_p) {
             ASSERT(cb_data_p->time != nullptr && cb_data_p->time->type == vpiSimTime);
             
             uint64_t time = (((uint64_t) cb_data_p->time->high << 32) | (cb_data_p->time->low));
-#ifdef USE_FSDB
-            uint64_t targetTime = fsdbWaveVpi->xtagU64Vec[cursor.index] + time;
-            uint64_t targetIndex = fsdbWaveVpi->findNearestTimeIndex(targetTime);
-#else
-            uint64_t targetTime = wellen_get_time_from_index(cursor.index) + time;
-            uint64_t targetIndex = wellen_get_index_from_time(targetTime);            
-#endif
+            uint64_t targetTime = timeTable[cursor.index] + time;
+            uint64_t targetIndex = timeTable.findIndex(targetTime, cursor.index); // The target is usually a few indices ahead of the cursor
             ASSERT(targetTime <= cursor.maxTime);
 
             willAppendTimeCbQueue.emplace_back(std::make_pair(targetIndex, std::make_shared<t_cb_data>(*cb_data_p)));
@@ -1275,6 +2771,565 @@ PLI_INT32 vpi_remove_cb(vpiHandle cb_obj) {
     return 0;
 }
 
+// Profile-guided warm start.
+// The signals that were read or watched are saved into PROFILE_FILE at the end of simulation. The next run against the same wave file resolves and loads all of them in one batch before `cbStartOfSimulation`,
+// and the hot ones are handed to the JIT right away instead of waiting for `jitHotAccessThreshold` reads.
+//
+// PROFILE_FILE format:
+//      <wave file size>
+//      <wave file last write time>
+//      <readCnt> <watched> <name>
+//      ...
+void loadProfile() {
+    std::ifstream profileFile(PROFILE_FILE);
+    if(!profileFile.is_open()) {
+        fmt::println("[wave_vpi] loadProfile no profile found => {}", PROFILE_FILE);
+        return;
+    }
+
+    auto waveFileSize = std::filesystem::file_size(waveFilePath);
+    auto lastWriteTime = (uint64_t)std::filesystem::last_write_time(waveFilePath).time_since_epoch().count();
+
+    std::vector<ProfileEntry> entries;
+    try {
+        std::string line;
+        std::getline(profileFile, line);
+        auto _waveFileSize = std::stoull(line);
+        std::getline(profileFile, line);
+        auto _lastWriteTime = std::stoull(line);
+
+        if(_waveFileSize != waveFileSize || _lastWriteTime != lastWriteTime) {
+            fmt::println("[wave_vpi] loadProfile wave file has been modified, ignore {}", PROFILE_FILE);
+            return;
+        }
+
+        while(std::getline(profileFile, line)) {
+            auto firstSpace = line.find(' ');
+            auto secondSpace = line.find(' ', firstSpace + 1);
+            if(firstSpace == std::string::npos || secondSpace == std::string::npos) {
+                continue;
+            }
+            entries.emplace_back(ProfileEntry{
+                .name = line.substr(secondSpace + 1),
+                .readCnt = std::stoull(line.substr(0, firstSpace)),
+                .watched = line[firstSpace + 1] == '1'
+            });
+        }
+    } catch(std::logic_error &e) {
+        fmt::println("[wave_vpi] loadProfile ERROR while reading:{}! => {}", PROFILE_FILE, e.what());
+        return;
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // Load all the profiled signals in one batch instead of one by one while the script is running.
+#ifdef USE_FSDB
+    for(auto &entry : entries) {
+        fsdbWaveVpi->fsdbObj->ffrAddToSignalList(fsdbWaveVpi->getVarIdCodeByName(const_cast<char *>(entry.name.c_str())));
+    }
+    fsdbWaveVpi->fsdbObj->ffrLoadSignals();
+#else
+    std::vector<const char *> names;
+    names.reserve(entries.size());
+    for(auto &entry : entries) {
+        names.emplace_back(entry.name.c_str());
+    }
+    wellen_vpi_preload_signals(names.data(), names.size());
+#endif
+
+    uint64_t hotCnt = 0;
+    for(auto &entry : entries) {
+        auto vpiHdl = vpi_handle_by_name(const_cast<PLI_BYTE8 *>(entry.name.c_str()), nullptr);
+#ifdef USE_FSDB
+        auto fsdbSigHdl = reinterpret_cast<FsdbSignalHandlePtr>(vpiHdl);
+        if(enableJIT && !fsdbSigHdl->periodic && !fsdbSigHdl->stored && fsdbSigHdl->group == nullptr && fsdbSigHdl->bitSize <= 32 && entry.readCnt > jitHotAccessThreshold) {
+            profileHotHdls.emplace_back(fsdbSigHdl); // Started by `startProfileJit()`
+            hotCnt++;
+        }
+#else
+        (void)vpiHdl; // Only creates the handle
+#endif
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    fmt::println("[wave_vpi] loadProfile preload {} signals({} hot) from {}, time: {} ms", entries.size(), hotCnt, PROFILE_FILE, std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+}
+
+#ifdef USE_FSDB
+// Start the JIT-like optimization of the hot signals found by `loadProfile()`. It runs from the main loop setup instead of `loadProfile()` so that no optimization thread is running when the workers of a sharded replay are forked(see `runShards()`), and the first window starts at the replay window.
+void startProfileJit() {
+    for(auto fsdbSigHdl : profileHotHdls) {
+        if(!fsdbSigHdl->doOpt && fsdbSigHdl->group == nullptr) {
+            jitStartOpt(fsdbSigHdl);
+        }
+    }
+    profileHotHdls.clear();
+}
+#endif
+
+void saveProfile() {
+    std::ofstream profileFile(PROFILE_FILE);
+    if(!profileFile.is_open()) {
+        VL_WARN("Failed to open {}, profile will not be saved\n", PROFILE_FILE);
+        return;
+    }
+
+    profileFile << std::filesystem::file_size(waveFilePath) << std::endl;
+    profileFile << (uint64_t)std::filesystem::last_write_time(waveFilePath).time_since_epoch().count() << std::endl;
+
+    uint64_t savedCnt = 0;
+    for(auto &[name, vpiHdl] : handleCache) {
+        auto sigHdl = reinterpret_cast<SignalHandlePtr>(vpiHdl);
+        if(sigHdl->readCnt == 0 && !sigHdl->watched) {
+            continue;
+        }
+        profileFile << sigHdl->readCnt << " " << (sigHdl->watched ? 1 : 0) << " " << name << std::endl;
+        savedCnt++;
+    }
+    profileFile.close();
+
+    fmt::println("[wave_vpi] saveProfile save {} signals into {}", savedCnt, PROFILE_FILE);
+}
+
+// Walk the value changes of `handle` once and map them onto the time table.
+// The walk stops once `maxChanges` changes are collected, returns false in that case.
+bool extractChangeList(vpiHandle handle, ChangeList &changeList, uint64_t maxChanges) {
+    ASSERT(handle != nullptr);
+    changeList.indices.clear();
+    changeList.values.clear();
+    changeList.knownFromIdx = 0;
+    bool complete = true;
+
+#ifdef USE_FSDB
+    auto fsdbSigHdl = reinterpret_cast<FsdbSignalHandlePtr>(handle);
+    auto vcTrvsHdl = fsdbSigHdl->vcTrvsHdl;
+    changeList.bitSize = fsdbSigHdl->bitSize;
+
+    fsdbXTag xtag;
+    byte_T *retVC;
+    uint64_t index = 0;
+    if(FSDB_RC_SUCCESS == vcTrvsHdl->ffrGotoTheFirstVC()) {
+        do {
+            vcTrvsHdl->ffrGetXTag((void *)&xtag);
+            if(FSDB_RC_SUCCESS != vcTrvsHdl->ffrGetVC(&retVC)) [[unlikely]] {
+                PANIC("vcTrvsHdl->ffrGetVC() failed!", fsdbSigHdl->name);
+            }
+            if(vcTrvsHdl->ffrGetBytesPerBit() != FSDB_BYTES_PER_BIT_1B) [[unlikely]] {
+                PANIC("TODO: FSDB_BYTES_PER_BIT_4B/8B", fsdbSigHdl->name);
+            }
+
+            // `vpi_get_value` reads at `time + 1`, so a change at `changeTime` is visible from the first index whose time is not less than `changeTime - 1`.
+            auto changeTime = Xtag64ToUInt64(xtag.hltag);
+            auto visibleTime = changeTime == 0 ? 0 : changeTime - 1;
+            index = timeTable.findIndex(visibleTime, index);
+            if(timeTable[index] < visibleTime) {
+                if(index == cursor.maxIndex) {
+                    break;
+                }
+                index++;
+            }
+
+            uint64_t value = 0;
+            bool unknown = false;
+            for(size_t i = 0; i < fsdbSigHdl->bitSize; i++) {
+                value = (value << 1) | (retVC[i] == FSDB_BT_VCD_1 ? 1 : 0); // treat `X`/`Z` as `0`
+                unknown = unknown || retVC[i] == FSDB_BT_VCD_X || retVC[i] == FSDB_BT_VCD_Z;
+            }
+            changeList.append(index, value, unknown);
+            if(changeList.indices.size() >= maxChanges) {
+                complete = false;
+                break;
+            }
+        } while(FSDB_RC_SUCCESS == vcTrvsHdl->ffrGotoNextVC());
+    }
+#else
+    auto wellenSigHdl = reinterpret_cast<WellenSignalHandlePtr>(handle);
+    changeList.bitSize = wellen_vpi_get(vpiSize, wellenSigHdl->wellenHdl);
+
+    struct IterContext {
+        ChangeList *changeList;
+        uint64_t maxChanges;
+        bool complete;
+    } context = {&changeList, maxChanges, true};
+    wellen_vpi_iter_changes(wellenSigHdl->wellenHdl, &context, [](void *_context, uint64_t index, uint64_t value, bool unknown) {
+        auto context = reinterpret_cast<IterContext *>(_context);
+        context->changeList->append(index, value, unknown);
+        if(context->changeList->indices.size() >= context->maxChanges) {
+            context->complete = false;
+            return false;
+        }
+        return true;
+    });
+    complete = context.complete;
+#endif
+
+    // No value before the first change, use default value: 0
+    if(changeList.indices.empty() || changeList.indices[0] != 0) {
+        changeList.indices.insert(changeList.indices.begin(), 0);
+        changeList.values.insert(changeList.values.begin(), 0);
+    }
+    return complete;
+}
+
+// Reserve the memory of a value store in `valueStoreBudget`, falling back to the change-point layout if `layout` does not fit.
+bool reserveValueStore(AdaptiveValueVec<uint32_t>::Layout &layout, uint64_t changeCnt, uint64_t size) {
+    using Layout = AdaptiveValueVec<uint32_t>::Layout;
+    if(valueStoreBudget.reserve(AdaptiveValueVec<uint32_t>::estimateBytes(layout, changeCnt, size))) {
+        return true;
+    }
+    if(layout != Layout::ChangePoint && valueStoreBudget.reserve(AdaptiveValueVec<uint32_t>::estimateBytes(Layout::ChangePoint, changeCnt, size))) {
+        layout = Layout::ChangePoint;
+        return true;
+    }
+    return false;
+}
+
+// Replace the storage of a signal once it is loaded:
+//      1. strictly periodic 1-bit signals(e.g. clocks) => analytic model(`periodicClock`). The model works on the time-table times at which the changes become visible, so `periodicClock.valueAt(timeTable[index])` always equals the value read at `index`.
+//      2. other 1-bit signals, and signals with at most 32 bits on wellen => `valueStore`, whose layout(dense, bit-packed or change-point) is chosen from the measured change density and the remaining `valueStoreBudget`.
+// Multi-bit FSDB signals are left to the JIT, which builds the same kind of store window by window.
+void setupValueStore(vpiHandle handle) {
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+    size_t bitSize = vpi_get(vpiSize, handle);
+    ChangeList changeList;
+    std::vector<uint64_t> times;
+
+#ifdef USE_FSDB
+    if(bitSize != 1) {
+        return;
+    }
+#else
+    if(bitSize > 32) {
+        return;
+    }
+#endif
+
+    auto detect = [&]() {
+        if(!enableAnalyticClock || bitSize != 1) {
+            return false;
+        }
+        times.resize(changeList.indices.size());
+        for(size_t i = 0; i < times.size(); i++) {
+            times[i] = timeTable[changeList.indices[i]];
+        }
+        return sigHdl->periodicClock.detect(times, changeList.values, PERIODIC_CLOCK_MIN_EDGES);
+    };
+
+    // Most 1-bit signals are not clocks, reject them from a short prefix before walking the whole signal.
+    bool complete = extractChangeList(handle, changeList, PERIODIC_CLOCK_PROBE_CHANGES);
+    bool periodic = detect();
+    if(!complete && (periodic || enableValueStore)) {
+        extractChangeList(handle, changeList);
+        periodic = periodic && detect();
+    }
+
+    // The replaced storages are two-state, a signal that holds `X`/`Z` until the end is left to the wave file.
+    if(changeList.knownFromIdx == UINT64_MAX) {
+        return;
+    }
+    sigHdl->knownFromIdx = changeList.knownFromIdx;
+
+    if(periodic) {
+        sigHdl->periodic = true;
+        fmt::println("[wave_vpi] {} is a periodic clock => period: {} edges: {}", sigHdl->name, sigHdl->periodicClock.getPeriod(), sigHdl->periodicClock.getEdgeCnt());
+    } else if(enableValueStore) {
+        uint64_t changeCnt = changeList.indices.size();
+        auto layout = AdaptiveValueVec<uint32_t>::chooseLayout(changeCnt, timeTable.size(), valueStoreCompactDensity, bitSize);
+        if(!reserveValueStore(layout, changeCnt, timeTable.size())) {
+            VL_WARN("valueStoreBudget is exhausted, {} will be read from the wave file\n", sigHdl->name);
+            return;
+        }
+        sigHdl->valueStore.build(changeList.indices, changeList.values, timeTable.size(), layout);
+        sigHdl->stored = true;
+        valueStoreCnt++;
+    }
+}
+
+// First index after `index` at which `edge` happens on a signal with a replaced storage(see `setupValueStore()` and `buildValueGroup()`), UINT64_MAX if there is none.
+uint64_t findNextEdge(vpiHandle handle, uint64_t index, SignalEdge edge) {
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+    if(sigHdl->periodic) {
+        auto time = sigHdl->periodicClock.nextEdgeTime(timeTable[index], edge);
+        return time == UINT64_MAX ? UINT64_MAX : timeTable.findIndex(time, index);
+    }
+    if(sigHdl->group != nullptr) {
+        return sigHdl->group->nextEdge(index, sigHdl->groupSlot, edge);
+    }
+    ASSERT(sigHdl->stored, "findNextEdge only supports periodic, stored or grouped signals", sigHdl->name);
+    return sigHdl->valueStore.nextEdge(index, edge);
+}
+
+// Last index at or before `index` at which `edge` happens, UINT64_MAX if there is none. Same storages as `findNextEdge()`.
+uint64_t findPrevEdge(vpiHandle handle, uint64_t index, SignalEdge edge) {
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+    if(sigHdl->periodic) {
+        auto time = sigHdl->periodicClock.prevEdgeTime(timeTable[index], edge);
+        return time == UINT64_MAX ? UINT64_MAX : timeTable.findIndex(time, index);
+    }
+    if(sigHdl->group != nullptr) {
+        return sigHdl->group->prevEdge(index, sigHdl->groupSlot, edge);
+    }
+    ASSERT(sigHdl->stored, "findPrevEdge only supports periodic, stored or grouped signals", sigHdl->name);
+    return sigHdl->valueStore.prevEdge(index, edge);
+}
+
+// Append the indices of the `edge`s of `handle` to `indices` in increasing order. Periodic, stored and grouped signals find their edges without walking the signal again.
+void collectEdges(vpiHandle handle, SignalEdge edge, std::vector<uint64_t> &indices) {
+    auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+    if(sigHdl->periodic || sigHdl->stored || sigHdl->group != nullptr) {
+        for(auto index = findNextEdge(handle, 0, edge); index != UINT64_MAX; index = findNextEdge(handle, index, edge)) {
+            indices.emplace_back(index);
+        }
+        return;
+    }
+
+    ChangeList changeList;
+    extractChangeList(handle, changeList);
+    for(size_t i = 1; i < changeList.indices.size(); i++) {
+        if(isEdge(changeList.values[i - 1], changeList.values[i], edge)) {
+            indices.emplace_back(changeList.indices[i]);
+        }
+    }
+}
+
+// Read `handle` as if the cursor were at `index`. The getters only look at `cursor.index`, except for the streamed FSDB signals whose `streamVC` follows the real cursor.
+static void getValueAtIndex(vpiHandle handle, uint64_t index, p_vpi_value value_p) {
+    if(index == cursor.index) {
+        vpi_get_value(handle, value_p);
+        return;
+    }
+    auto savedIndex = cursor.index;
+    cursor.index = index;
+    cursorShifted = true;
+    vpi_get_value(handle, value_p);
+    cursorShifted = false;
+    cursor.index = savedIndex;
+}
+
+// Read `handle` at `cursor.index + offset`, a negative offset looks back and a positive one looks ahead since the whole wave is already known. Returns false(and leaves `value_p` untouched) if the index is out of the time table.
+// This replaces the script-side ring buffers and delayed callbacks. Value stores and groups serve any index in O(1), other signals seek the wave file like a normal read.
+extern "C" bool wave_vpi_get_value_offset(vpiHandle handle, int64_t offset, p_vpi_value value_p) {
+    if((offset < 0 && static_cast<uint64_t>(-offset) > cursor.index) || (offset > 0 && static_cast<uint64_t>(offset) > cursor.maxIndex - cursor.index)) {
+        return false;
+    }
+    getValueAtIndex(handle, cursor.index + offset, value_p);
+    return true;
+}
+
+// Read `handle` `edges` edges of `clock` away from the cursor, `edge` is a `SignalEdge`(0: posedge, 1: negedge, 2: any edge). Edge 0 is the last edge at or before `cursor.index`, so with a cursor on a clock edge `edges = -3` is the value 3 cycles ago.
+// Returns false(and leaves `value_p` untouched) if there is no such edge. The edge indices of a clock are built once, later lookups start from the previous position and cost O(1) while the cursor moves forward.
+extern "C" bool wave_vpi_get_value_edges(vpiHandle handle, vpiHandle clock, uint32_t edge, int64_t edges, p_vpi_value value_p) {
+    ASSERT(edge <= static_cast<uint32_t>(SignalEdge::Any), "Unknown edge", edge);
+    auto clockHdl = reinterpret_cast<SignalHandlePtr>(clock);
+    if(clockHdl->clockEdges == nullptr) {
+        clockHdl->clockEdges = std::make_unique<ClockEdges>();
+    }
+    auto &indices = clockHdl->clockEdges->indices[edge];
+    auto &pos = clockHdl->clockEdges->pos[edge];
+    if(!clockHdl->clockEdges->built[edge]) {
+        collectEdges(clock, static_cast<SignalEdge>(edge), indices);
+        clockHdl->clockEdges->built[edge] = true;
+    }
+
+    // `pos` is the number of edges at or before `cursor.index`
+    while(pos < indices.size() && indices[pos] <= cursor.index) {
+        pos++;
+    }
+    while(pos > 0 && indices[pos - 1] > cursor.index) {
+        pos--;
+    }
+
+    auto target = static_cast<int64_t>(pos) - 1 + edges;
+    if(target < 0 || target >= static_cast<int64_t>(indices.size())) {
+        return false;
+    }
+    getValueAtIndex(handle, indices[target], value_p);
+    return true;
+}
+
+// Build the stepping timeline of the main loop from the clock edges given by WAVE_VPI_STEP_CLOCK, e.g.
+//      WAVE_VPI_STEP_CLOCK=top.clock:posedge
+//      WAVE_VPI_STEP_CLOCK=top.clock:posedge,top.dut.slow_clock:negedge
+//      WAVE_VPI_STEP_CLOCK=top.clock:edge
+// The edge defaults to `posedge`. When it is not set, the main loop steps through every index of the time table.
+void buildStepTimeline() {
+    auto _stepClock = std::getenv("WAVE_VPI_STEP_CLOCK");
+    if(_stepClock == nullptr || std::string(_stepClock).empty()) {
+        return;
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::stringstream ss(_stepClock);
+    std::string item;
+    while(std::getline(ss, item, ',')) {
+        if(item.empty()) {
+            continue;
+        }
+
+        auto colon = item.rfind(':');
+        auto clockName = item.substr(0, colon);
+        auto edge = colon == std::string::npos ? std::string("posedge") : item.substr(colon + 1);
+        ASSERT(edge == "posedge" || edge == "negedge" || edge == "edge", "Unknown edge in WAVE_VPI_STEP_CLOCK", item);
+
+        auto handle = vpi_handle_by_name(const_cast<PLI_BYTE8 *>(clockName.c_str()), nullptr);
+        ASSERT(handle != nullptr, "Failed to find clock in WAVE_VPI_STEP_CLOCK", clockName);
+
+        ASSERT(vpi_get(vpiSize, handle) == 1, "WAVE_VPI_STEP_CLOCK only supports 1-bit clocks", clockName);
+
+        auto clockEdge = edge == "posedge" ? SignalEdge::Posedge : (edge == "negedge" ? SignalEdge::Negedge : SignalEdge::Any);
+        collectEdges(handle, clockEdge, stepIndices);
+    }
+
+    std::sort(stepIndices.begin(), stepIndices.end());
+    stepIndices.erase(std::unique(stepIndices.begin(), stepIndices.end()), stepIndices.end());
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    fmt::println("[wave_vpi] WAVE_VPI_STEP_CLOCK:{} => {} steps out of {} time table indices, time: {} ms", _stepClock, stepIndices.size(), timeTable.size(), std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+}
+
+// Store `handles` time-major in one or more `GroupedValueVec`s of at most VALUE_GROUP_MAX_SLOTS members, so that a step reading all of them touches one or two cache lines.
+// Signals wider than 32 bits, periodic clocks, already grouped signals and signals owned by the JIT are left out. A member that had its own `valueStore` gives its memory back to `valueStoreBudget`.
+void buildValueGroup(const std::vector<vpiHandle> &handles, const std::string &source) {
+    std::vector<SignalHandlePtr> members;
+    for(auto handle : handles) {
+        auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+        bool groupable = sigHdl->bitSize <= 32 && !sigHdl->periodic && sigHdl->group == nullptr;
+#ifdef USE_FSDB
+        groupable = groupable && !sigHdl->doOpt;
+#endif
+        if(groupable && std::find(members.begin(), members.end(), sigHdl) == members.end()) {
+            members.emplace_back(sigHdl);
+        }
+    }
+
+    for(size_t start = 0; start + 1 < members.size(); start += VALUE_GROUP_MAX_SLOTS) {
+        uint32_t slotCnt = std::min<size_t>(VALUE_GROUP_MAX_SLOTS, members.size() - start);
+        if(!valueStoreBudget.reserve(GroupedValueVec<uint32_t>::estimateBytes(slotCnt, timeTable.size()))) {
+            VL_WARN("valueStoreBudget is exhausted, value group({}) is not built\n", source);
+            return;
+        }
+
+        auto group = std::make_unique<GroupedValueVec<uint32_t>>();
+        group->init(timeTable.size(), slotCnt);
+        std::string names;
+        ChangeList changeList;
+        for(uint32_t slot = 0; slot < slotCnt; slot++) {
+            auto sigHdl = members[start + slot];
+            if(sigHdl->stored) {
+                group->fillSlot(slot, [&](uint64_t idx) { return sigHdl->valueStore.get(idx); });
+                valueStoreBudget.release(sigHdl->valueStore.memoryUsage());
+                sigHdl->valueStore = AdaptiveValueVec<uint32_t>();
+                sigHdl->stored = false;
+                valueStoreCnt--;
+            } else {
+                extractChangeList(reinterpret_cast<vpiHandle>(sigHdl), changeList);
+                group->buildSlot(slot, changeList.indices, changeList.values);
+                sigHdl->knownFromIdx = changeList.knownFromIdx;
+            }
+            sigHdl->group = group.get();
+            sigHdl->groupSlot = slot;
+            sigHdl->getterFormat = 0; // Bind the getter again, see `bindValueGetter()`
+            names += (slot == 0 ? "" : ", ") + sigHdl->name;
+        }
+
+        fmt::println("[wave_vpi] value group({}) => {} members: {}", source, slotCnt, names);
+        valueGroups.emplace_back(std::move(group));
+    }
+}
+
+// Build the value groups declared by WAVE_VPI_VALUE_GROUPS, groups are separated by `;` and members by `,`. A member may list the fields of a bundle in braces, e.g.
+//      WAVE_VPI_VALUE_GROUPS=top.dut.task_s3_valid,top.dut.task_s3_bits_channel;top.dut.auto_in_a_{valid,ready,address,source}
+void buildDeclaredValueGroups() {
+    auto _valueGroups = std::getenv("WAVE_VPI_VALUE_GROUPS");
+    if(_valueGroups == nullptr || std::string(_valueGroups).empty()) {
+        return;
+    }
+
+    std::stringstream groupSs(_valueGroups);
+    std::string groupStr;
+    while(std::getline(groupSs, groupStr, ';')) {
+        // Expand `prefix{a,b}suffix` before splitting the members
+        std::vector<std::string> names;
+        size_t pos = 0;
+        while(pos < groupStr.size()) {
+            auto comma = groupStr.find(',', pos);
+            auto brace = groupStr.find('{', pos);
+            if(brace != std::string::npos && (comma == std::string::npos || brace < comma)) {
+                auto close = groupStr.find('}', brace);
+                ASSERT(close != std::string::npos, "Unbalanced `{` in WAVE_VPI_VALUE_GROUPS", groupStr);
+                auto end = groupStr.find(',', close);
+                end = end == std::string::npos ? groupStr.size() : end;
+                auto prefix = groupStr.substr(pos, brace - pos);
+                auto suffix = groupStr.substr(close + 1, end - close - 1);
+                std::stringstream fieldSs(groupStr.substr(brace + 1, close - brace - 1));
+                std::string field;
+                while(std::getline(fieldSs, field, ',')) {
+                    names.emplace_back(prefix + field + suffix);
+                }
+                pos = end + 1;
+            } else {
+                comma = comma == std::string::npos ? groupStr.size() : comma;
+                names.emplace_back(groupStr.substr(pos, comma - pos));
+                pos = comma + 1;
+            }
+        }
+
+        std::vector<vpiHandle> handles;
+        for(auto &name : names) {
+            if(name.empty()) {
+                continue;
+            }
+            auto handle = vpi_handle_by_name(const_cast<PLI_BYTE8 *>(name.c_str()), nullptr);
+            ASSERT(handle != nullptr, "Failed to find signal in WAVE_VPI_VALUE_GROUPS", name);
+            handles.emplace_back(handle);
+        }
+        buildValueGroup(handles, "declared");
+    }
+}
+
+// Group the signals that were read together during the first `valueGroupProbeSteps` main-loop steps(WAVE_VPI_VALUE_GROUP_AUTO).
+// The most read signal that is not grouped yet seeds a group, then every other signal whose reads fall in the seed's steps at least VALUE_GROUP_MIN_OVERLAP of the time joins it. Guard signals such as `valid`, which is read at every step while its payload is only read when it is set, end up with their payload.
+void buildAutoValueGroups() {
+    std::vector<SignalHandlePtr> candidates;
+    for(auto &[name, handle] : handleCache) {
+        auto sigHdl = reinterpret_cast<SignalHandlePtr>(handle);
+        if(sigHdl->coAccessCnt != 0 && sigHdl->group == nullptr) {
+            candidates.emplace_back(sigHdl);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](SignalHandlePtr a, SignalHandlePtr b) {
+        return a->coAccessCnt != b->coAccessCnt ? a->coAccessCnt > b->coAccessCnt : a->name < b->name;
+    });
+
+    std::vector<bool> assigned(candidates.size(), false);
+    for(size_t seed = 0; seed < candidates.size(); seed++) {
+        if(assigned[seed]) {
+            continue;
+        }
+        std::vector<vpiHandle> handles{reinterpret_cast<vpiHandle>(candidates[seed])};
+        for(size_t i = seed + 1; i < candidates.size() && handles.size() < VALUE_GROUP_MAX_SLOTS; i++) {
+            if(assigned[i]) {
+                continue;
+            }
+            uint64_t overlap = 0;
+            for(size_t w = 0; w < candidates[i]->coAccessSteps.size(); w++) {
+                overlap += std::popcount(candidates[i]->coAccessSteps[w] & candidates[seed]->coAccessSteps[w]);
+            }
+            if(overlap >= VALUE_GROUP_MIN_OVERLAP * candidates[i]->coAccessCnt) {
+                assigned[i] = true;
+                handles.emplace_back(reinterpret_cast<vpiHandle>(candidates[i]));
+            }
+        }
+        if(handles.size() > 1) {
+            buildValueGroup(handles, "auto");
+        }
+    }
+
+    for(auto sigHdl : candidates) {
+        std::vector<uint64_t>().swap(sigHdl->coAccessSteps);
+    }
+}
+
 // Unsupport:
 //      vpi_put_value(handle, &v, NULL, vpiNoDelay); // wave_vpi is considered a read-only waveform simulate backend in verilua
 // 
@@ -4,12 +4,14 @@
 #include "fmt/core.h"
 #include "libassert/assert.hpp"
 
+#include <cstdarg>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <csignal>
+#include <cmath>
 #include <iostream>
 #include <memory>
 #include <queue>
@@ -20,15 +22,31 @@
 #include <vector>
 #include <string>
 #include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <utility>
 #include <algorithm>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
 #include <chrono>
+#include <functional>
 #include "sys/stat.h"
+#include "value_store.h"
+#include "bit_convert.h"
+#include "time_table.h"
 
 #define LAST_MODIFIED_TIME_FILE "last_modified_time.wave_vpi_fsdb"
 #define TIME_TABLE_FILE "time_table.wave_vpi_fsdb"
+#define NAME_INDEX_FILE "name_index.wave_vpi_fsdb"
+#define PROFILE_FILE "profile.wave_vpi"
+
+#define VALUE_STORE_DEFAULT_COMPACT_DENSITY 0.25 // Change density below which a multi-bit value store uses the change-point layout. This value can be overridden by enviroment variable: WAVE_VPI_VALUE_STORE_COMPACT_DENSITY
+#define VALUE_GROUP_MAX_SLOTS 16              // Members of one value group, 16 values of 32 bits span one cache line
+#define VALUE_GROUP_DEFAULT_PROBE_STEPS 1024  // Main-loop steps observed before the co-accessed signals are grouped. This value can be overridden by enviroment variable: WAVE_VPI_VALUE_GROUP_PROBE_STEPS
+#define VALUE_GROUP_MIN_OVERLAP 0.9           // A signal joins a group when at least this ratio of its reads happen in the steps that also read the most accessed member
+#define PERIODIC_CLOCK_MIN_EDGES 8       // 1-bit signals with fewer edges are never treated as periodic clocks
+#define PERIODIC_CLOCK_PROBE_CHANGES 64  // Number of changes checked before walking a whole 1-bit signal, so that non-clock signals are rejected cheaply
 
 #ifdef VL_DEF_OPT_USE_BOOST_UNORDERED
 #warning "[wave_vpi] VL_DEF_OPT_USE_BOOST_UNORDERED is defined!"
@@ -45,7 +63,6 @@
 
 #include "ffrAPI.h"
 #include "fsdbShr.h"
-#include <set>
 
 #ifndef FALSE
 #define FALSE 0
@@ -99,8 +116,14 @@ extern "C" {
     void wellen_test_1();
 
     void *wellen_vpi_handle_by_name(const char *name);
+    void wellen_vpi_preload_signals(const char **names, size_t count);
     void wellen_vpi_get_value(void *handle, uint64_t time, p_vpi_value value_p);
     void wellen_vpi_get_value_from_index(void *handle, uint64_t time_table_idx, p_vpi_value value_p);
+    bool wellen_vpi_get_vector_from_index(void *handle, uint64_t time_table_idx, s_vpi_vecval *vecvals, size_t len);
+    void wellen_vpi_iter_vector_range(void *handle, uint64_t start_idx, uint64_t end_idx, size_t len, void *context, bool (*callback)(void *context, uint64_t time_table_idx, const s_vpi_vecval *vecvals));
+    void wellen_vpi_iter_vector_range_rev(void *handle, uint64_t from_idx, size_t len, void *context, bool (*callback)(void *context, uint64_t time_table_idx, const s_vpi_vecval *vecvals));
+    void wellen_vpi_reopen(const char *filename);
+    bool wellen_vpi_get_vector_span(void *handle, uint64_t time_table_idx, s_vpi_vecval *vecvals, size_t len, uint64_t *span);
 
     PLI_INT32 wellen_vpi_get(PLI_INT32 property, void *handle);
     PLI_BYTE8 *wellen_vpi_get_str(PLI_INT32 property, void *object);
@@ -111,11 +134,24 @@ extern "C" {
     uint64_t wellen_get_index_from_time(uint64_t time);
 
     char *wellen_get_value_str(void *handle, uint64_t time_table_idx);
+    void wellen_vpi_iter_changes(void *handle, void *context, bool (*callback)(void *context, uint64_t time_table_idx, uint64_t value, bool unknown));
 
     void wellen_vpi_finalize();
 }
 #endif
 
+// Time table of the wave, shared by both backends. The wellen backend fills it through `wave_vpi_time_table_init`.
+extern TimeTable timeTable;
+
+#ifndef USE_FSDB
+extern "C" {
+    void wave_vpi_time_table_init(const uint64_t *times, size_t size);
+    uint64_t wave_vpi_time_table_get(uint64_t index);
+    uint64_t wave_vpi_time_table_find_index(uint64_t time);
+    uint64_t wave_vpi_time_table_size();
+}
+#endif
+
 struct WaveCursor {
     CursorTime_t time;
     CursorTime_t maxTime;
@@ -123,21 +159,90 @@ struct WaveCursor {
     uint64_t index;
     uint64_t maxIndex;
 
-#ifndef USE_FSDB
     void updateTime(uint64_t time) {
         this->time = time;
-        this->index = wellen_get_index_from_time(time);
+        this->index = timeTable.findIndex(time, this->index);
     }
 
     void updateIndex(uint64_t index) {
         this->index = index;
-        this->time = wellen_get_time_from_index(index);
+        this->time = timeTable[index];
     }
-#endif
 };
 
 using vpiHandleRaw = PLI_UINT32;
 using vpiCbFunc = PLI_INT32 (*)(struct t_cb_data *);
+using ValueGetter = void (*)(vpiHandle object, p_vpi_value value_p); // See `bindValueGetter()`
+
+// Edge indices of a signal used as a clock by `wave_vpi_get_value_edges`, built on first use for each kind of edge.
+struct ClockEdges {
+    std::vector<uint64_t> indices[3]; // Indexed by `SignalEdge`
+    bool built[3] = {false, false, false};
+    uint64_t pos[3] = {0, 0, 0}; // Position of the last lookup, the cursor usually moves by a few edges between two lookups
+};
+
+// Value slot of a signal, see `wave_vpi_register_value_slot`. The layout is part of the C API, script bindings may declare it as is(e.g. with LuaJIT FFI) and read it with plain loads.
+typedef struct {
+    uint64_t seq;          // Incremented each time the value changes
+    uint64_t index;        // `cursor.index` of the last refresh
+    uint32_t bitSize;
+    uint32_t wordCnt;      // Entries of `vecvals`
+    s_vpi_vecval *vecvals; // The value in the `vpiVectorVal` layout, least significant word first
+} ValueSlot;
+
+extern "C" {
+    ValueSlot *wave_vpi_register_value_slot(vpiHandle handle);
+    uint64_t wave_vpi_get_values(vpiHandle handle, uint64_t startIdx, uint64_t endIdx, uint64_t stride, s_vpi_vecval *out);
+    uint64_t wave_vpi_get_changes(vpiHandle handle, uint64_t startIdx, uint64_t endIdx, uint64_t *indices, s_vpi_vecval *values, uint64_t maxChanges);
+    bool wave_vpi_get_value_offset(vpiHandle handle, int64_t offset, p_vpi_value value_p);
+    bool wave_vpi_get_value_edges(vpiHandle handle, vpiHandle clock, uint32_t edge, int64_t edges, p_vpi_value value_p);
+    uint64_t wave_vpi_next_change(vpiHandle handle, uint64_t fromIdx);
+    uint64_t wave_vpi_prev_change(vpiHandle handle, uint64_t fromIdx);
+    uint64_t wave_vpi_next_value(vpiHandle handle, uint64_t fromIdx, uint64_t value);
+    uint64_t wave_vpi_next_bit_edge(vpiHandle handle, uint64_t fromIdx, uint32_t bit, uint32_t edge);
+}
+
+// `vpi_control` operation of `wave_vpi_seek`, called as `vpi_control(vpiWaveSeek, const WaveSeekNode *nodes, uint32_t nodeCnt, uint64_t *skippedTime)`. The value is outside of the operations of IEEE 1800.
+#define vpiWaveSeek 0x5701
+
+#define waveSeekTerm 0 // `(value(handle) & mask) == (value & mask)`, X/Z bits under `mask` never match
+#define waveSeekAnd 1
+#define waveSeekOr 2
+
+// Node of a seek condition, `nodes[0]` is the root. The children of an And/Or node are `nodes[first]` to `nodes[first + count - 1]` and must come after it. Only the low 64 bits of a signal can be compared.
+typedef struct {
+    PLI_INT32 op;
+    vpiHandle handle; // Term only
+    uint64_t mask;    // Term only
+    uint64_t value;   // Term only
+    uint32_t first;   // And/Or only
+    uint32_t count;   // And/Or only
+} WaveSeekNode;
+
+// `vpi_control` operation of `wave_vpi_set_window`, called as `vpi_control(vpiWaveWindow, uint32_t unit, uint64_t start, uint64_t end)`.
+#define vpiWaveWindow 0x5702
+
+#define waveWindowIndex 0
+#define waveWindowTime 1
+
+// Shard of a sharded replay, see `runShards()`. A worker replays [warmupIdx, endIdx] and should only count the results of [startIdx, endIdx), the warm-up brings the state of the scripts up to date.
+typedef struct {
+    int32_t index;      // -1 in the parent process and when the replay is not sharded
+    uint32_t count;     // 1 when the replay is not sharded
+    uint64_t warmupIdx;
+    uint64_t startIdx;
+    uint64_t endIdx;
+} WaveShardInfo;
+
+using WaveShardMerge = void (*)(void *context, uint32_t shard, const void *data, size_t size);
+
+extern "C" {
+    bool wave_vpi_seek(const WaveSeekNode *nodes, uint32_t nodeCnt, uint64_t *skippedTime);
+    void wave_vpi_set_window(uint32_t unit, uint64_t start, uint64_t end);
+    const WaveShardInfo *wave_vpi_shard_info();
+    bool wave_vpi_shard_report(const void *data, size_t size);
+    void wave_vpi_shard_set_merge(WaveShardMerge merge, void *context);
+}
 
 #ifdef USE_FSDB
 
@@ -145,11 +250,31 @@ using vpiCbFunc = PLI_INT32 (*)(struct t_cb_data *);
 #define JTT_DEFAULT_COMPILE_THRESHOLD  200000
 #define JIT_DEFAULT_RECOMPILE_WINDOW_SIZE 200000
 #define JIT_DEFAULT_MAX_OPT_THREADS 20 // Maximum threads(default) that are allowed to be run for JIT optimization. This value can be overridden by enviroment variable: WAVE_VPI_MAX_OPT_THREADS
+#define JIT_DEFAULT_ADAPT_INTERVAL 100000 // Cursor steps between two adjustments of the adaptive JIT controller. This value can be overridden by enviroment variable: WAVE_VPI_JIT_ADAPT_INTERVAL
+#define JIT_ADAPT_STALL_RATE 0.01 // Stall rate(stalled reads / optimized reads) above which the JIT is considered to fall behind the cursor
+#define JIT_ADAPT_MIN_READS 1000 // Optimized reads an adjustment interval needs before the JIT is considered to keep up with the cursor, an idle interval says nothing about it
+#define JIT_ADAPT_HOT_ACCESS_FLOOR_DIV 4 // The adaptive hot access threshold never goes below its initial value divided by this factor
+#define JIT_DEFAULT_COMPACT_DENSITY 0.25 // Signals whose change density(changes / indices) in the first compile window is below this value are stored as change points instead of a dense array. This value can be overridden by enviroment variable: WAVE_VPI_JIT_COMPACT_DENSITY
 
-#define MAX_SCOPE_DEPTH 100
 #define TIME_TABLE_MAX_INDEX_VAR_CODE 10
-#define TIME_TABLE_MAX_INDEX_VAR_CODE_MAX 2000
+#define TIME_TABLE_DEFAULT_MAX_THREADS 16 // Maximum threads(default) used to build the time table. This value can be overridden by enviroment variable: WAVE_VPI_FSDB_TIME_TABLE_THREADS
+#define TIME_TABLE_COMPACT_SIZE (1 << 22) // Number of collected times after which a time table thread sorts and deduplicates its times
 #define Xtag64ToUInt64(xtag64) (uint64_t)(((uint64_t)xtag64.H << 32) + xtag64.L)
+#define TIME_TABLE_FILE_CHUNK_SIZE (1 << 20) // Number of times read/written at once from/to TIME_TABLE_FILE
+
+inline fsdbXTag UInt64ToXtag(uint64_t time) {
+    fsdbXTag xtag;
+    xtag.hltag.H = time >> 32;
+    xtag.hltag.L = time & 0xFFFFFFFF;
+    return xtag;
+}
+
+// A var of the name index, the full name is `nameArena[offset, offset + length)`.
+struct FsdbNameIndexEntry {
+    uint64_t offset;
+    uint32_t length;
+    fsdbVarIdcode idcode;
+};
 
 class FsdbWaveVpi {
   public:
@@ -157,19 +282,66 @@ class FsdbWaveVpi {
     ffrObject *fsdbObj;
     ffrFSDBInfo fsdbInfo;
     fsdbVarIdcode maxVarIdcode;
-    fsdbVarIdcode sigArr[TIME_TABLE_MAX_INDEX_VAR_CODE_MAX];
-    ffrTimeBasedVCTrvsHdl tbVcTrvsHdl;
 
-    uint32_t sigNum = TIME_TABLE_MAX_INDEX_VAR_CODE;
-    std::vector<uint64_t> xtagU64Vec;
-    std::vector<fsdbXTag> xtagVec;
 
-    UNORDERED_MAP<std::string, fsdbVarIdcode> varIdCodeCache; // TODO: store into json file at the end of simulation and read back at the start of simulation
+    // Full name => idcode of every var, built by one traversal of the scope tree or read back from NAME_INDEX_FILE. The keys point into `nameArena`.
+    std::string nameArena;
+    UNORDERED_MAP<std::string_view, fsdbVarIdcode> nameIndex;
 
     FsdbWaveVpi(ffrObject *fsdbObj, std::string_view waveFileName);
     ~FsdbWaveVpi() {};
     fsdbVarIdcode getVarIdCodeByName(char *name);
-    uint32_t findNearestTimeIndex(uint64_t time);
+
+  private:
+    void buildTimeTable(const std::vector<fsdbVarIdcode> &varIdCodes);
+    void buildNameIndex(std::vector<FsdbNameIndexEntry> &entries);
+    void indexNames(const std::vector<FsdbNameIndexEntry> &entries);
+    bool loadNameIndex();
+    void saveNameIndex(const std::vector<FsdbNameIndexEntry> &entries);
+};
+
+// Adaptive controller of the JIT knobs.
+// It samples the reader stall rate, the window refill throughput of the optimization threads and the core availability every `adaptInterval` cursor steps, and adjusts the knobs that are not pinned by the enviroment variables.
+class JitController {
+  public:
+    bool enable = true;
+    uint64_t adaptInterval = JIT_DEFAULT_ADAPT_INTERVAL;
+    uint64_t minHotAccessThreshold = std::max<uint64_t>(JTT_DEFAULT_HOT_ACCESS_THRESHOLD / JIT_ADAPT_HOT_ACCESS_FLOOR_DIV, 1);
+
+    bool pinMaxOptThreads = false;
+    bool pinHotAccessThreshold = false;
+    bool pinCompileWindowSize = false;
+    bool pinRecompileWindowSize = false;
+
+    // Updated by the reader(main thread)
+    uint64_t readCnt = 0;  // Reads served by optimized signals
+    uint64_t stallCnt = 0; // Reads of optimized signals that fell back to FSDB because the compile window was not ready yet
+
+    // Updated by the optimization threads
+    std::atomic<uint64_t> refillIndexCnt = 0;
+    std::atomic<uint64_t> refillNs = 0;
+
+    void recordRefill(uint64_t indexCnt, uint64_t ns) {
+        refillIndexCnt.fetch_add(indexCnt, std::memory_order_relaxed);
+        refillNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    inline void tick(uint64_t cursorIndex) {
+        if(cursorIndex >= nextUpdateIndex) [[unlikely]] {
+            update(cursorIndex);
+        }
+    }
+
+    void update(uint64_t cursorIndex);
+    void report();
+
+  private:
+    uint64_t nextUpdateIndex = JIT_DEFAULT_ADAPT_INTERVAL;
+    uint64_t lastIndex = 0;
+    uint64_t lastReadCnt = 0;
+    uint64_t lastStallCnt = 0;
+    uint64_t adjustCnt = 0;
+    std::chrono::steady_clock::time_point lastTime = std::chrono::steady_clock::now();
 };
 
 typedef struct {
@@ -178,30 +350,202 @@ typedef struct {
     fsdbVarIdcode varIdCode;
     size_t bitSize;
 
+    bool watched = false;
+
+    // Loaded signals may be read from `periodicClock` or `valueStore` instead of the FSDB, see `setupValueStore()`.
+    bool periodic = false;
+    PeriodicClock periodicClock;
+    bool stored = false;
+    AdaptiveValueVec<uint32_t> valueStore;
+    uint64_t knownFromIdx = 0; // The replaced storages are two-state, indices before this one may hold `X`/`Z` and are read from the wave file
+
+    // Members of a value group are read from `group` instead, see `buildValueGroup()`. `coAccessSteps` is the bitmap of the probed main-loop steps in which the signal was read.
+    GroupedValueVec<uint32_t> *group = nullptr;
+    uint32_t groupSlot = 0;
+    std::vector<uint64_t> coAccessSteps;
+    uint64_t coAccessCnt = 0;
+
+    // Output buffers of `vpi_get_value`, sized from `bitSize` when the handle is created. A returned vector or string stays valid until the next read of the same signal.
+    std::vector<s_vpi_vecval> vecvalBuffer;
+    std::vector<uint32_t> wordBuffer;
+    std::vector<char> strBuffer;
+
+    // Reader of the value for `getterFormat`, bound on the first read with that format. Zero means unbound.
+    ValueGetter getter = nullptr;
+    PLI_INT32 getterFormat = 0;
+
+    // Registered by `wave_vpi_register_value_slot`, refreshed by the main loop
+    std::unique_ptr<ValueSlot> valueSlot;
+    std::vector<s_vpi_vecval> valueSlotVecvals;
+
+    std::unique_ptr<ClockEdges> clockEdges; // See `wave_vpi_get_value_edges`
+
+    // Used by FsdbStreamer, `streamVC` always holds the value of the signal at `cursor.index` when `streamed` is true.
+    bool streamed = false;
+    std::vector<byte_T> streamVC;
+    fsdbBytesPerBit streamBpb;
+
     // Used by JIT-like feature
     uint64_t readCnt = 0;
     std::thread optThread;
     bool doOpt = false;
     bool optFinish = false;
     bool continueOpt = false;
-    std::vector<uint32_t> optValueVec;
-    uint64_t optFinishIdx;
+    AdaptiveValueVec<uint32_t> optValueVec;
+    uint64_t optStartIdx = 0; // Start of the first window, `optValueVec` holds nothing before it
+    std::atomic<uint64_t> optFinishIdx = 0; // Stored once the blocks before it are written, together with their entries in `optBlockKnownFrom`
+    std::vector<uint16_t> optBlockKnownFrom; // Same as `knownFromIdx` for each block of `optValueVec`, as an offset in the block. Values before it may hold `X`/`Z` and are read from the FSDB
     std::condition_variable cv;
     std::mutex mtx;
 } FsdbSignalHandle, *FsdbSignalHandlePtr;
 
+using SignalHandle = FsdbSignalHandle;
+using SignalHandlePtr = FsdbSignalHandlePtr;
+
+// Streaming mode for the watched and hot signals.
+// Instead of seeking every signal with its own `ffrVCTrvsHdl` at every step, one `ffrTimeBasedVCTrvsHdl` is created over all the streamed signals and advanced with `ffrGotoNextVC()` in lockstep with the cursor.
+// Each value change is copied into `streamVC` of the signal handles, which turns N seeks per step into one sequential merged stream.
+class FsdbStreamer {
+  public:
+    bool enable = false;
+
+    void addSignal(FsdbSignalHandlePtr fsdbSigHdl);
+    void advance(uint64_t index);
+    void seek(uint64_t index);
+    void report();
+
+  private:
+    ffrTimeBasedVCTrvsHdl tbVcTrvsHdl = nullptr;
+    std::vector<fsdbVarIdcode> varIdCodes;
+    UNORDERED_MAP<fsdbVarIdcode, std::vector<FsdbSignalHandlePtr>> sigHdlMap;
+    std::vector<FsdbSignalHandlePtr> pendingSigHdls;
+
+    // The value change that the traverse handle currently points to, it is applied once the cursor reaches its time.
+    bool hasPendingVC = false;
+    bool finished = false;
+    uint64_t pendingVCTime = 0;
+
+    uint64_t rebuildCnt = 0;
+    uint64_t vcCnt = 0;
+
+    void rebuild(uint64_t index);
+    void catchUp(uint64_t index);
+    void applyVC();
+};
+
+#else
+
+typedef struct {
+    std::string name;
+    void *wellenHdl;
+    size_t bitSize;
+    bool watched = false;
+    uint64_t readCnt = 0;
+
+    // Loaded signals may be read from `periodicClock` or `valueStore` instead of wellen, see `setupValueStore()`.
+    bool periodic = false;
+    PeriodicClock periodicClock;
+    bool stored = false;
+    AdaptiveValueVec<uint32_t> valueStore;
+    uint64_t knownFromIdx = 0; // The replaced storages are two-state, indices before this one may hold `X`/`Z` and are read from the wave file
+
+    // Members of a value group are read from `group` instead, see `buildValueGroup()`. `coAccessSteps` is the bitmap of the probed main-loop steps in which the signal was read.
+    GroupedValueVec<uint32_t> *group = nullptr;
+    uint32_t groupSlot = 0;
+    std::vector<uint64_t> coAccessSteps;
+    uint64_t coAccessCnt = 0;
+
+    // Output buffers of `vpi_get_value`, sized from `bitSize` when the handle is created. `vecvalBuffer` is also filled by `wellen_vpi_get_vector_from_index` for `vpiVectorVal`.
+    std::vector<s_vpi_vecval> vecvalBuffer;
+    std::vector<char> strBuffer;
+
+    // Reader of the value for `getterFormat`, bound on the first read with that format. Zero means unbound.
+    ValueGetter getter = nullptr;
+    PLI_INT32 getterFormat = 0;
+
+    // Registered by `wave_vpi_register_value_slot`, refreshed by the main loop
+    std::unique_ptr<ValueSlot> valueSlot;
+    std::vector<s_vpi_vecval> valueSlotVecvals;
+
+    std::unique_ptr<ClockEdges> clockEdges; // See `wave_vpi_get_value_edges`
+} WellenSignalHandle, *WellenSignalHandlePtr;
+
+using SignalHandle = WellenSignalHandle;
+using SignalHandlePtr = WellenSignalHandlePtr;
+
+#endif
+
+// Packed values of the members of a bundle, see `wave_vpi_bundle_create`. The layout is part of the C API like `ValueSlot`.
+typedef struct {
+    uint64_t seq;            // Incremented each time any member changes
+    uint64_t index;          // `cursor.index` of the last gather
+    uint32_t memberCnt;
+    uint32_t wordCnt;        // Entries of `vecvals`
+    const uint32_t *offsets; // The words of member `i` are `vecvals[offsets[i]]` to `vecvals[offsets[i + 1] - 1]`
+    s_vpi_vecval *vecvals;   // The values of the members back to back, each one in the `vpiVectorVal` layout
+} BundleValue;
+
+struct BundleHandle {
+    std::string name;
+    std::vector<SignalHandlePtr> members;
+    std::vector<uint32_t> offsets;
+    std::vector<s_vpi_vecval> vecvals;
+    BundleValue value;
+};
+
+extern "C" {
+    vpiHandle wave_vpi_bundle_create(const vpiHandle *handles, size_t count, const char *name);
+    const BundleValue *wave_vpi_bundle_get(vpiHandle bundle);
+}
+
+// Value of one signal cached by a read cursor together with the indices over which it holds, so that a cursor that moves forward only goes to the wave again when the signal changes.
+struct CursorSpan {
+    uint64_t startIdx = UINT64_MAX; // The value holds over [startIdx, endIdx)
+    uint64_t endIdx = 0;
+    std::vector<s_vpi_vecval> vecvals;
+    std::string str;
+#ifdef USE_FSDB
+    ffrVCTrvsHdl vcTrvsHdl = nullptr; // Own traverse handle, the one of the signal handle follows the main loop
 #endif
+};
+
+// Read position over the loaded wave that is independent of `cursor`, see `wave_vpi_cursor_create`.
+struct WaveReadCursor {
+    uint64_t index = 0;
+    UNORDERED_MAP<SignalHandlePtr, CursorSpan> spans;
+#ifdef USE_FSDB
+    ffrObject *fsdbObj = nullptr; // Own fsdb object, opened on the first wave read and closed by `wave_vpi_cursor_free`
+#endif
+};
+
+extern "C" {
+    WaveReadCursor *wave_vpi_cursor_create();
+    void wave_vpi_cursor_free(WaveReadCursor *readCursor);
+    void wave_vpi_cursor_set_index(WaveReadCursor *readCursor, uint64_t index);
+    void wave_vpi_cursor_set_time(WaveReadCursor *readCursor, uint64_t time);
+    uint64_t wave_vpi_cursor_get_index(const WaveReadCursor *readCursor);
+    void wave_vpi_cursor_get_value(WaveReadCursor *readCursor, vpiHandle handle, p_vpi_value value_p);
+}
 
 struct ValueCbInfo {
     std::shared_ptr<s_cb_data> cbData;
-#ifdef USE_FSDB
     vpiHandle handle;
+#ifdef USE_FSDB
     size_t bitSize;
     uint32_t bitValue;
-#else
-    vpiHandleRaw handle;
 #endif
     std::string valueStr;
+
+    // A callback on a bundle fires when any member changes, see `wave_vpi_bundle_create`
+    BundleHandle *bundle = nullptr;
+    uint64_t bundleSeq = 0;
+};
+
+// One line of the profile file, see `loadProfile()`/`saveProfile()`.
+struct ProfileEntry {
+    std::string name;
+    uint64_t readCnt;
+    bool watched;
 };
 
 #ifdef USE_FSDB
@@ -211,6 +555,64 @@ uint32_t fsdbGetSingleBitValue(vpiHandle object);
 std::string _wellen_get_value_str(vpiHandle object);
 #endif
 
+void loadProfile();
+void saveProfile();
+#ifdef USE_FSDB
+void startProfileJit();
+#endif
+
+// Value changes of a signal over the time table, see `extractChangeList()`.
+// Only the lower 64 bits of the value are kept and X/Z are read as 0, the same as `vpiIntVal`.
+struct ChangeList {
+    uint32_t bitSize = 0;
+    std::vector<uint64_t> indices; // Strictly increasing time-table indices, the first one is always 0
+    std::vector<uint64_t> values;  // `values[i]` holds from `indices[i]` until `indices[i + 1]`, `X`/`Z` bits are read as `0`
+    uint64_t knownFromIdx = 0;     // First index from which no value holds `X`/`Z`, UINT64_MAX if the last value does
+
+    // Changes must be appended in non-decreasing index order, the last change of the same index wins and changes to the same value are dropped.
+    void append(uint64_t index, uint64_t value, bool unknown = false) {
+        if(unknown) {
+            knownFromIdx = UINT64_MAX;
+        } else if(knownFromIdx == UINT64_MAX) {
+            knownFromIdx = index;
+        }
+
+        if(!indices.empty() && indices.back() == index) {
+            values.back() = value;
+            if(values.size() >= 2 && values[values.size() - 2] == value) {
+                indices.pop_back();
+                values.pop_back();
+            }
+            return;
+        }
+        if(!values.empty() && values.back() == value) {
+            return;
+        }
+        indices.emplace_back(index);
+        values.emplace_back(value);
+    }
+
+    uint64_t valueAt(uint64_t index) const {
+        auto it = std::upper_bound(indices.begin(), indices.end(), index);
+        return it == indices.begin() ? 0 : values[it - indices.begin() - 1];
+    }
+};
+
+bool extractChangeList(vpiHandle handle, ChangeList &changeList, uint64_t maxChanges = UINT64_MAX);
+bool reserveValueStore(AdaptiveValueVec<uint32_t>::Layout &layout, uint64_t changeCnt, uint64_t size);
+void setupValueStore(vpiHandle handle);
+void buildValueGroup(const std::vector<vpiHandle> &handles, const std::string &source);
+void buildDeclaredValueGroups();
+void buildAutoValueGroups();
+uint64_t findNextEdge(vpiHandle handle, uint64_t index, SignalEdge edge);
+uint64_t findPrevEdge(vpiHandle handle, uint64_t index, SignalEdge edge);
+void collectEdges(vpiHandle handle, SignalEdge edge, std::vector<uint64_t> &indices);
+void updateValueSlots();
+void gatherBundle(BundleHandle *bundle);
+
+void buildStepTimeline();
+void runShards();
+
 void wave_vpi_init(const char *filename);
 void wave_vpi_main();
 
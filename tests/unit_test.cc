@@ -3,6 +3,7 @@
 #include "vpi_user.h"
 #include "catch2/catch_session.hpp"
 #include "catch2/catch_test_macros.hpp"
+#include "catch2/benchmark/catch_benchmark.hpp"
 #include "fmt/core.h"
 #include <cstdlib>
 
@@ -49,6 +50,415 @@ TEST_CASE("vpi_get_value", "[vpi_get_value]") {
     fmt::println("v => {}", v.value.str);
 }
 
+TEST_CASE("vpi_get_value formats", "[vpi_get_value]") {
+    // Every format is served by its own prebound getter, switching formats on the same handle must keep them consistent
+    for(auto name : {"top.masslav_if.clk", "top.masslav_if.Paddr"}) {
+        auto hdl = vpi_handle_by_name(const_cast<PLI_BYTE8 *>(name), nullptr);
+        for(int i = 0; i < 20; i++) {
+            cursor.updateTime(i * 5);
+            s_vpi_value v{.format = vpiBinStrVal};
+            vpi_get_value(hdl, &v);
+            auto binStr = std::string(v.value.str);
+            if(binStr.find_first_of("xz") != std::string::npos) {
+                continue;
+            }
+            auto expect = static_cast<uint32_t>(std::stoull(binStr, nullptr, 2));
+
+            v.format = vpiIntVal;
+            vpi_get_value(hdl, &v);
+            REQUIRE(static_cast<uint32_t>(v.value.integer) == expect);
+
+            v.format = vpiVectorVal;
+            vpi_get_value(hdl, &v);
+            REQUIRE(static_cast<uint32_t>(v.value.vector[0].aval) == expect);
+            REQUIRE(v.value.vector[0].bval == 0);
+
+            v.format = vpiHexStrVal;
+            vpi_get_value(hdl, &v);
+            REQUIRE(std::stoull(v.value.str, nullptr, 16) == expect);
+        }
+    }
+}
+
+TEST_CASE("wave_vpi_register_value_slot", "[vpi_get_value]") {
+    auto hdl = vpi_handle_by_name("top.masslav_if.Paddr", nullptr);
+    cursor.updateTime(0);
+    auto slot = wave_vpi_register_value_slot(hdl);
+    REQUIRE(slot == wave_vpi_register_value_slot(hdl));
+    REQUIRE(slot->bitSize == 32);
+    REQUIRE(slot->wordCnt == 1);
+
+    s_vpi_value v{.format = vpiVectorVal};
+    auto prevSeq = slot->seq;
+    auto prev = slot->vecvals[0];
+    for(int i = 0; i < 20; i++) {
+        cursor.updateTime(i * 5);
+        updateValueSlots();
+        REQUIRE(slot->index == cursor.index);
+        vpi_get_value(hdl, &v);
+        REQUIRE(slot->vecvals[0].aval == v.value.vector[0].aval);
+        REQUIRE(slot->vecvals[0].bval == v.value.vector[0].bval);
+        auto changed = slot->vecvals[0].aval != prev.aval || slot->vecvals[0].bval != prev.bval;
+        REQUIRE(slot->seq == prevSeq + (changed ? 1 : 0));
+        prevSeq = slot->seq;
+        prev = slot->vecvals[0];
+    }
+}
+
+TEST_CASE("wave_vpi_get_values/wave_vpi_get_changes", "[vpi_get_value]") {
+    for(auto name : {"top.masslav_if.clk", "top.masslav_if.Paddr"}) {
+        auto hdl = vpi_handle_by_name(const_cast<PLI_BYTE8 *>(name), nullptr);
+        uint64_t startIdx = 3, endIdx = std::min<uint64_t>(200, timeTable.size());
+
+        std::vector<s_vpi_vecval> expect;
+        s_vpi_value v{.format = vpiVectorVal};
+        for(auto idx = startIdx; idx < endIdx; idx++) {
+            cursor.updateIndex(idx);
+            vpi_get_value(hdl, &v);
+            expect.emplace_back(v.value.vector[0]);
+        }
+        auto sameValue = [](const s_vpi_vecval &a, const s_vpi_vecval &b) { return a.aval == b.aval && a.bval == b.bval; };
+
+        for(uint64_t stride : {1, 3}) {
+            std::vector<s_vpi_vecval> values(endIdx - startIdx);
+            auto cnt = wave_vpi_get_values(hdl, startIdx, endIdx, stride, values.data());
+            REQUIRE(cnt == (endIdx - startIdx + stride - 1) / stride);
+            for(uint64_t i = 0; i < cnt; i++) {
+                REQUIRE(sameValue(values[i], expect[i * stride]));
+            }
+        }
+
+        std::vector<uint64_t> indices(endIdx - startIdx);
+        std::vector<s_vpi_vecval> values(endIdx - startIdx);
+        auto cnt = wave_vpi_get_changes(hdl, startIdx, endIdx, indices.data(), values.data(), indices.size());
+        REQUIRE(cnt >= 1);
+        REQUIRE(indices[0] == startIdx);
+        for(uint64_t i = 0, idx = startIdx; idx < endIdx; idx++) {
+            if(i + 1 < cnt && indices[i + 1] == idx) {
+                REQUIRE(!sameValue(values[i + 1], values[i]));
+                i++;
+            }
+            REQUIRE(sameValue(values[i], expect[idx - startIdx]));
+        }
+    }
+}
+
+TEST_CASE("wave_vpi_bundle_create", "[vpi_get_value]") {
+    vpiHandle handles[] = {vpi_handle_by_name("top.masslav_if.clk", nullptr), vpi_handle_by_name("top.masslav_if.Paddr", nullptr)};
+    cursor.updateTime(0);
+    auto bundle = wave_vpi_bundle_create(handles, 2, "bundle_test");
+    auto value = wave_vpi_bundle_get(bundle);
+    REQUIRE(value->memberCnt == 2);
+    REQUIRE(value->wordCnt == 2);
+
+    s_vpi_value v{.format = vpiVectorVal};
+    auto prevSeq = value->seq;
+    for(int i = 0; i < 20; i++) {
+        cursor.updateTime(i * 5);
+        auto prev = std::vector<s_vpi_vecval>(value->vecvals, value->vecvals + value->wordCnt);
+        REQUIRE(wave_vpi_bundle_get(bundle) == value);
+        bool changed = false;
+        for(int m = 0; m < 2; m++) {
+            vpi_get_value(handles[m], &v);
+            auto &got = value->vecvals[value->offsets[m]];
+            REQUIRE(got.aval == v.value.vector[0].aval);
+            REQUIRE(got.bval == v.value.vector[0].bval);
+            changed = changed || got.aval != prev[m].aval || got.bval != prev[m].bval;
+        }
+        REQUIRE(value->seq == prevSeq + (changed ? 1 : 0));
+        prevSeq = value->seq;
+    }
+}
+
+TEST_CASE("wave_vpi_get_value_offset/wave_vpi_get_value_edges", "[vpi_get_value]") {
+    auto clk = vpi_handle_by_name("top.masslav_if.clk", nullptr);
+    auto hdl = vpi_handle_by_name("top.masslav_if.Paddr", nullptr);
+    auto endIdx = std::min<uint64_t>(100, timeTable.size());
+
+    std::vector<uint32_t> expect;
+    std::vector<uint64_t> posedges;
+    s_vpi_value v{.format = vpiIntVal};
+    int prevClk = 0;
+    for(uint64_t idx = 0; idx < endIdx; idx++) {
+        cursor.updateIndex(idx);
+        vpi_get_value(hdl, &v);
+        expect.emplace_back(v.value.integer);
+        vpi_get_value(clk, &v);
+        if(prevClk == 0 && v.value.integer == 1) {
+            posedges.emplace_back(idx);
+        }
+        prevClk = v.value.integer;
+    }
+
+    cursor.updateIndex(10);
+    for(int64_t offset = -10; offset < static_cast<int64_t>(endIdx) - 10; offset++) {
+        REQUIRE(wave_vpi_get_value_offset(hdl, offset, &v));
+        REQUIRE(static_cast<uint32_t>(v.value.integer) == expect[10 + offset]);
+    }
+    REQUIRE(!wave_vpi_get_value_offset(hdl, -11, &v));
+
+    for(size_t p = 0; p + 2 < posedges.size(); p++) {
+        cursor.updateIndex(posedges[p + 1]);
+        REQUIRE(wave_vpi_get_value_edges(hdl, clk, static_cast<uint32_t>(SignalEdge::Posedge), -1, &v));
+        REQUIRE(static_cast<uint32_t>(v.value.integer) == expect[posedges[p]]);
+        REQUIRE(wave_vpi_get_value_edges(hdl, clk, static_cast<uint32_t>(SignalEdge::Posedge), 1, &v));
+        REQUIRE(static_cast<uint32_t>(v.value.integer) == expect[posedges[p + 2]]);
+    }
+}
+
+TEST_CASE("wave_vpi_next_change/wave_vpi_prev_change", "[vpi_get_value]") {
+    auto endIdx = std::min<uint64_t>(200, timeTable.size());
+    for(auto name : {"top.masslav_if.clk", "top.masslav_if.Paddr"}) {
+        auto hdl = vpi_handle_by_name(const_cast<PLI_BYTE8 *>(name), nullptr);
+        std::vector<uint32_t> expect;
+        s_vpi_value v{.format = vpiIntVal};
+        for(uint64_t idx = 0; idx < endIdx; idx++) {
+            cursor.updateIndex(idx);
+            vpi_get_value(hdl, &v);
+            expect.emplace_back(v.value.integer);
+        }
+
+        for(uint64_t idx = 0; idx < endIdx; idx++) {
+            uint64_t next = idx + 1;
+            while(next < endIdx && expect[next] == expect[next - 1]) {
+                next++;
+            }
+            auto found = wave_vpi_next_change(hdl, idx);
+            REQUIRE(next < endIdx ? found == next : found >= endIdx);
+            if(next < endIdx) {
+                REQUIRE(wave_vpi_next_value(hdl, idx, expect[next]) <= next);
+            }
+
+            uint64_t prev = idx;
+            while(prev > 0 && expect[prev] == expect[prev - 1]) {
+                prev--;
+            }
+            REQUIRE(wave_vpi_prev_change(hdl, idx) == (prev == 0 ? UINT64_MAX : prev));
+        }
+    }
+
+    auto clk = vpi_handle_by_name("top.masslav_if.clk", nullptr);
+    for(uint64_t idx = 0; idx + 1 < endIdx; idx++) {
+        REQUIRE(wave_vpi_next_value(clk, idx, 1) == wave_vpi_next_bit_edge(clk, idx, 0, static_cast<uint32_t>(SignalEdge::Posedge)));
+    }
+}
+
+TEST_CASE("wave_vpi_seek", "[vpi_get_value]") {
+    auto clk = vpi_handle_by_name("top.masslav_if.clk", nullptr);
+    auto hdl = vpi_handle_by_name("top.masslav_if.Paddr", nullptr);
+    auto endIdx = std::min<uint64_t>(200, timeTable.size());
+
+    std::vector<uint32_t> expectClk, expect;
+    s_vpi_value v{.format = vpiIntVal};
+    for(uint64_t idx = 0; idx < endIdx; idx++) {
+        cursor.updateIndex(idx);
+        vpi_get_value(clk, &v);
+        expectClk.emplace_back(v.value.integer);
+        vpi_get_value(hdl, &v);
+        expect.emplace_back(v.value.integer);
+    }
+
+    // clk == 1 && (Paddr == a || Paddr[7:0] == b[7:0])
+    uint64_t a = expect[endIdx * 3 / 4], b = expect[endIdx / 2];
+    WaveSeekNode nodes[] = {
+        {.op = waveSeekAnd, .first = 1, .count = 2},
+        {.op = waveSeekTerm, .handle = clk, .mask = 1, .value = 1},
+        {.op = waveSeekOr, .first = 3, .count = 2},
+        {.op = waveSeekTerm, .handle = hdl, .mask = ~0ULL, .value = a},
+        {.op = waveSeekTerm, .handle = hdl, .mask = 0xff, .value = b},
+    };
+    uint64_t match = 0;
+    while(match < endIdx && !(expectClk[match] == 1 && (expect[match] == a || (expect[match] & 0xff) == (b & 0xff)))) {
+        match++;
+    }
+
+    cursor.updateIndex(0);
+    uint64_t skippedTime;
+    if(match < endIdx) {
+        REQUIRE(vpi_control(vpiWaveSeek, nodes, static_cast<uint32_t>(std::size(nodes)), &skippedTime) == 1);
+        REQUIRE(cursor.index == match);
+        REQUIRE(skippedTime == timeTable[match] - timeTable[0]);
+
+        // Already there
+        REQUIRE(wave_vpi_seek(nodes, std::size(nodes), &skippedTime));
+        REQUIRE(cursor.index == match);
+        REQUIRE(skippedTime == 0);
+    }
+
+    // The match is after the end of the replay window
+    if(match > 0 && match < endIdx) {
+        wave_vpi_set_window(waveWindowIndex, 0, match - 1);
+        REQUIRE(cursor.index == 0);
+        REQUIRE(!wave_vpi_seek(nodes, std::size(nodes), &skippedTime));
+        REQUIRE(cursor.index == 0);
+
+        wave_vpi_set_window(waveWindowIndex, 0, match);
+        REQUIRE(wave_vpi_seek(nodes, std::size(nodes), &skippedTime));
+        REQUIRE(cursor.index == match);
+        wave_vpi_set_window(waveWindowIndex, 0, UINT64_MAX);
+    }
+}
+
+TEST_CASE("wave_vpi_set_window", "[vpi_control]") {
+    auto start = timeTable.size() / 3, end = timeTable.size() * 2 / 3;
+
+    REQUIRE(vpi_control(vpiWaveWindow, static_cast<uint32_t>(waveWindowTime), timeTable[start], timeTable[end]) == 1);
+    REQUIRE(cursor.index <= start);
+    REQUIRE(timeTable[cursor.index] == timeTable[start]);
+    REQUIRE((cursor.index == 0 || timeTable[cursor.index - 1] < timeTable[start]));
+
+    // Between two times
+    if(timeTable[start + 1] > timeTable[start] + 1) {
+        wave_vpi_set_window(waveWindowTime, timeTable[start] + 1, UINT64_MAX);
+        REQUIRE(cursor.index == start + 1);
+    }
+
+    wave_vpi_set_window(waveWindowIndex, start, end);
+    REQUIRE(cursor.index == start);
+
+    wave_vpi_set_window(waveWindowIndex, 0, UINT64_MAX);
+    REQUIRE(cursor.index == 0);
+}
+
+TEST_CASE("wave_vpi_shard_info", "[vpi_control]") {
+    auto info = wave_vpi_shard_info();
+    REQUIRE(info->index == -1);
+    REQUIRE(info->count == 1);
+
+    // Not a worker
+    uint64_t result = 1;
+    REQUIRE(!wave_vpi_shard_report(&result, sizeof(result)));
+}
+
+TEST_CASE("wave_vpi_cursor_create", "[vpi_get_value]") {
+    auto clk = vpi_handle_by_name("top.masslav_if.clk", nullptr);
+    auto hdl = vpi_handle_by_name("top.masslav_if.Paddr", nullptr);
+    auto endIdx = std::min<uint64_t>(200, timeTable.size());
+
+    std::vector<uint32_t> expectClk, expect;
+    s_vpi_value v{.format = vpiIntVal};
+    for(uint64_t idx = 0; idx < endIdx; idx++) {
+        cursor.updateIndex(idx);
+        vpi_get_value(clk, &v);
+        expectClk.emplace_back(v.value.integer);
+        vpi_get_value(hdl, &v);
+        expect.emplace_back(v.value.integer);
+    }
+
+    // Two cursors apart from each other, the main cursor stays where it is
+    cursor.updateIndex(0);
+    auto request = wave_vpi_cursor_create();
+    auto response = wave_vpi_cursor_create();
+    for(uint64_t idx = 0; idx + 10 < endIdx; idx++) {
+        wave_vpi_cursor_set_index(request, idx);
+        wave_vpi_cursor_set_index(response, idx + 10);
+        wave_vpi_cursor_get_value(request, hdl, &v);
+        REQUIRE(static_cast<uint32_t>(v.value.integer) == expect[idx]);
+        wave_vpi_cursor_get_value(response, hdl, &v);
+        REQUIRE(static_cast<uint32_t>(v.value.integer) == expect[idx + 10]);
+    }
+    REQUIRE(cursor.index == 0);
+
+    // Backward
+    for(uint64_t idx = endIdx; idx-- > 0;) {
+        wave_vpi_cursor_set_index(request, idx);
+        wave_vpi_cursor_get_value(request, clk, &v);
+        REQUIRE(static_cast<uint32_t>(v.value.integer) == expectClk[idx]);
+    }
+    wave_vpi_cursor_free(request);
+    wave_vpi_cursor_free(response);
+
+    // Concurrent passes, one cursor per thread
+    std::atomic<uint64_t> mismatches = 0;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t]() {
+            auto readCursor = wave_vpi_cursor_create();
+            s_vpi_value value{.format = vpiIntVal};
+            for(uint64_t idx = t; idx < endIdx; idx++) {
+                wave_vpi_cursor_set_index(readCursor, idx);
+                wave_vpi_cursor_get_value(readCursor, hdl, &value);
+                mismatches += static_cast<uint32_t>(value.value.integer) != expect[idx];
+                wave_vpi_cursor_get_value(readCursor, clk, &value);
+                mismatches += static_cast<uint32_t>(value.value.integer) != expectClk[idx];
+            }
+            wave_vpi_cursor_free(readCursor);
+        });
+    }
+    for(auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE(mismatches == 0);
+
+    // X and Z bits, the span holds over the whole wave so that the value is not read back from the wave
+    auto readCursor = wave_vpi_cursor_create();
+    auto &span = readCursor->spans[reinterpret_cast<SignalHandlePtr>(hdl)];
+    span.startIdx = 0;
+    span.endIdx = UINT64_MAX;
+    span.vecvals = {s_vpi_vecval{.aval = 0x0000'00F5, .bval = 0x0000'000C}}; // 0b1111_zx01 at the lowest byte
+    wave_vpi_cursor_get_value(readCursor, hdl, &v);
+    REQUIRE(static_cast<uint32_t>(v.value.integer) == 0xF1);
+    v.format = vpiBinStrVal;
+    wave_vpi_cursor_get_value(readCursor, hdl, &v);
+    REQUIRE(std::string(v.value.str) == "0000000000000000000000001111zx01");
+    wave_vpi_cursor_free(readCursor);
+}
+
+#ifdef USE_FSDB
+extern std::atomic<uint64_t> jitHotAccessThreshold;
+
+TEST_CASE("wave_vpi_get_value_offset before the JIT window", "[vpi_get_value]") {
+    auto hdl = vpi_handle_by_name("top.masslav_if.Paddr", nullptr);
+    auto fsdbSigHdl = reinterpret_cast<FsdbSignalHandlePtr>(hdl);
+    auto endIdx = std::min<uint64_t>(200, timeTable.size());
+    std::vector<s_vpi_vecval> expect(endIdx);
+    REQUIRE(wave_vpi_get_values(hdl, 0, endIdx, 1, expect.data()) == endIdx);
+
+    // Start the JIT from the middle of the range, so that the first window does not cover the indices before it
+    s_vpi_value v{.format = vpiIntVal};
+    cursor.updateIndex(endIdx / 2);
+    for(uint64_t i = 0; i <= jitHotAccessThreshold + 1 && !fsdbSigHdl->doOpt; i++) {
+        vpi_get_value(hdl, &v);
+    }
+    for(int i = 0; i < 1000 && !fsdbSigHdl->optFinish; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(fsdbSigHdl->optFinish);
+
+    cursor.updateIndex(endIdx - 1);
+    for(int64_t k = 0; k < static_cast<int64_t>(endIdx); k++) {
+        REQUIRE(wave_vpi_get_value_offset(hdl, -k, &v));
+        REQUIRE(static_cast<uint32_t>(v.value.integer) == static_cast<uint32_t>(expect[endIdx - 1 - k].aval & ~expect[endIdx - 1 - k].bval));
+    }
+}
+#endif
+
+TEST_CASE("vpi_get_value output buffers", "[vpi_get_value]") {
+    // A returned vector or string belongs to the handle, reading another handle must leave it untouched
+    auto clk = vpi_handle_by_name("top.masslav_if.clk", nullptr);
+    auto hdl = vpi_handle_by_name("top.masslav_if.Paddr", nullptr);
+    auto endIdx = std::min<uint64_t>(200, timeTable.size());
+    for(uint64_t idx = 0; idx < endIdx; idx++) {
+        cursor.updateIndex(idx);
+        for(auto format : {vpiBinStrVal, vpiHexStrVal}) {
+            s_vpi_value a{.format = format}, b{.format = format};
+            vpi_get_value(clk, &a);
+            auto expect = std::string(a.value.str);
+            vpi_get_value(hdl, &b);
+            REQUIRE(a.value.str != b.value.str);
+            REQUIRE(std::string(a.value.str) == expect);
+        }
+
+        s_vpi_value a{.format = vpiVectorVal}, b{.format = vpiVectorVal};
+        vpi_get_value(clk, &a);
+        auto expect = a.value.vector[0];
+        vpi_get_value(hdl, &b);
+        REQUIRE(a.value.vector != b.value.vector);
+        REQUIRE(a.value.vector[0].aval == expect.aval);
+        REQUIRE(a.value.vector[0].bval == expect.bval);
+    }
+}
+
 TEST_CASE("vpi_get/vpi_get_str", "[vpi_get/vpi_get_str]") {
     auto hdl = vpi_handle_by_name("top.masslav_if.clk", nullptr);
     auto hdl2 = vpi_handle_by_name("top.masslav_if.Paddr", nullptr);
@@ -59,6 +469,277 @@ TEST_CASE("vpi_get/vpi_get_str", "[vpi_get/vpi_get_str]") {
 }
  
 
+TEST_CASE("TimeTable", "[TimeTable]") {
+    std::vector<uint64_t> times;
+    for(uint64_t i = 0; i < 1000; i++) {
+        times.emplace_back(i * 10 + (i % 7 == 0 ? 3 : 0)); // A clock with some jitter
+    }
+
+    TimeTable tt;
+    tt.build(times);
+    REQUIRE(tt.size() == times.size());
+    REQUIRE(tt.back() == times.back());
+    REQUIRE(tt.memoryUsage() < times.size() * sizeof(uint64_t));
+
+    for(uint64_t i = 0; i < times.size(); i++) {
+        REQUIRE(tt[i] == times[i]);
+        REQUIRE(tt.findIndex(times[i]) == i);
+        REQUIRE(tt.findIndex(times[i] + 1, i) == i);
+        REQUIRE(tt.findIndex(times[i], times.size() - 1) == i);
+    }
+    REQUIRE(tt.findIndex(times.back() + 100, 0) == times.size() - 1);
+}
+
+TEST_CASE("AdaptiveValueVec", "[AdaptiveValueVec]") {
+    using Layout = AdaptiveValueVec<uint32_t>::Layout;
+    const uint64_t size = 3 * VALUE_STORE_BLOCK_SIZE + 17;
+
+    for(auto layout : {Layout::Dense, Layout::Bit, Layout::ChangePoint}) {
+        // Changes right before, at and after the block boundaries as well as inside the blocks
+        uint32_t valueMask = layout == Layout::Bit ? 1 : 0xFFFF'FFFF;
+        std::vector<uint64_t> indices{0};
+        std::vector<uint32_t> values{0};
+        for(uint64_t idx = 1; idx < size; idx++) {
+            auto offset = idx & VALUE_STORE_BLOCK_MASK;
+            if(offset == 0 || offset == 1 || offset == VALUE_STORE_BLOCK_MASK || idx % 37 == 0) {
+                indices.emplace_back(idx);
+                values.emplace_back((values.back() + 0x1234'5679) & valueMask);
+            }
+        }
+        std::vector<uint32_t> expect(size);
+        for(size_t i = 0; i < indices.size(); i++) {
+            std::fill(expect.begin() + indices[i], i + 1 < indices.size() ? expect.begin() + indices[i + 1] : expect.end(), values[i]);
+        }
+
+        AdaptiveValueVec<uint32_t> built, written;
+        built.build(indices, values, size, layout);
+
+        // Written block by block and sealed before being read, the way the JIT fills a store
+        written.init(size, layout);
+        for(uint64_t start = 0; start < size; start = alignToBlock(start + 1)) {
+            auto finish = std::min<uint64_t>(alignToBlock(start + 1), size);
+            for(uint64_t idx = start; idx < finish; idx++) {
+                written.set(idx, expect[idx]);
+            }
+            written.seal(start, finish);
+        }
+        REQUIRE(built.getLayout() == layout);
+        REQUIRE(written.getLayout() == layout);
+
+        for(uint64_t idx = 0; idx < size; idx++) {
+            REQUIRE(built.get(idx) == expect[idx]);
+            REQUIRE(written.get(idx) == expect[idx]);
+        }
+        for(uint64_t idx = size; idx-- > 0;) {
+            REQUIRE(built.get(idx) == expect[idx]);
+        }
+        for(uint64_t idx = 0; idx < size; idx += VALUE_STORE_BLOCK_SIZE / 3) {
+            REQUIRE(built.get(idx) == expect[idx]);
+            REQUIRE(built.get(size - 1 - idx) == expect[size - 1 - idx]);
+        }
+
+        for(uint64_t idx = 0; idx < size; idx += 5) {
+            uint64_t next = UINT64_MAX, prev = UINT64_MAX;
+            for(uint64_t i = idx + 1; i < size && next == UINT64_MAX; i++) {
+                next = expect[i] != expect[i - 1] ? i : UINT64_MAX;
+            }
+            for(uint64_t i = idx + 1; i-- > 1 && prev == UINT64_MAX;) {
+                prev = expect[i] != expect[i - 1] ? i : UINT64_MAX;
+            }
+            REQUIRE(built.nextEdge(idx, SignalEdge::Any) == next);
+            REQUIRE(built.prevEdge(idx, SignalEdge::Any) == prev);
+        }
+    }
+
+    REQUIRE(AdaptiveValueVec<uint32_t>::chooseLayout(10, 10000, 0.1) == Layout::ChangePoint);
+    REQUIRE(AdaptiveValueVec<uint32_t>::chooseLayout(5000, 10000, 0.1) == Layout::Dense);
+    REQUIRE(AdaptiveValueVec<uint32_t>::chooseLayout(5000, 10000, 0.1, 1) == Layout::Bit);
+}
+
+TEST_CASE("PeriodicClock", "[PeriodicClock]") {
+    // Low until 5, then high for 3 and low for 7 in every period of 10
+    std::vector<uint64_t> times{0}, values{0};
+    for(uint64_t k = 0; k < 100; k++) {
+        times.emplace_back(5 + (k / 2) * 10 + (k % 2) * 3);
+        values.emplace_back(k % 2 == 0 ? 1 : 0);
+    }
+
+    PeriodicClock clock;
+    REQUIRE(clock.detect(times, values, 10));
+    REQUIRE(clock.getPeriod() == 10);
+    REQUIRE(clock.getEdgeCnt() == 100);
+
+    for(uint64_t time = 0; time < times.back() + 30; time++) {
+        auto k = std::upper_bound(times.begin(), times.end(), time) - times.begin() - 1;
+        REQUIRE(clock.valueAt(time) == values[k]);
+
+        // `times[0]` is the start of the wave, not an edge
+        uint64_t nextAny = UINT64_MAX, nextPos = UINT64_MAX;
+        for(size_t i = std::max<size_t>(k + 1, 1); i < times.size(); i++) {
+            nextAny = std::min(nextAny, times[i]);
+            if(values[i] == 1) {
+                nextPos = times[i];
+                break;
+            }
+        }
+        REQUIRE(clock.nextEdgeTime(time, SignalEdge::Any) == nextAny);
+        REQUIRE(clock.nextEdgeTime(time, SignalEdge::Posedge) == nextPos);
+    }
+
+    PeriodicClock other;
+    REQUIRE(!other.detect(times, values, 200)); // Fewer edges than asked for
+
+    auto gated = times;
+    gated[50] += 1;
+    REQUIRE(!other.detect(gated, values, 10));
+
+    auto multiBit = values;
+    multiBit[1] = 2;
+    REQUIRE(!other.detect(times, multiBit, 10));
+}
+
+TEST_CASE("GroupedValueVec", "[GroupedValueVec]") {
+    const uint64_t size = 3000;
+    std::vector<uint64_t> indices;
+    std::vector<uint32_t> values;
+    for(uint64_t idx = 0; idx < size; idx += 1 + idx % 13) {
+        indices.emplace_back(idx);
+        values.emplace_back((idx / 7) % 3); // Repeated values are not changes
+    }
+
+    GroupedValueVec<uint32_t> group;
+    group.init(size, 2);
+    group.buildSlot(0, indices, values);
+    group.fillSlot(1, [](uint64_t idx) { return (idx / 100) & 1; });
+
+    // Compare with a scan over every index
+    for(uint32_t slot = 0; slot < 2; slot++) {
+        for(auto edge : {SignalEdge::Posedge, SignalEdge::Negedge, SignalEdge::Any}) {
+            for(uint64_t idx = 0; idx < size; idx += 7) {
+                uint64_t next = UINT64_MAX, prev = UINT64_MAX;
+                for(uint64_t i = idx + 1; i < size && next == UINT64_MAX; i++) {
+                    next = isEdge(group.get(i - 1, slot), group.get(i, slot), edge) ? i : UINT64_MAX;
+                }
+                for(uint64_t i = idx + 1; i-- > 1 && prev == UINT64_MAX;) {
+                    prev = isEdge(group.get(i - 1, slot), group.get(i, slot), edge) ? i : UINT64_MAX;
+                }
+                REQUIRE(group.nextEdge(idx, slot, edge) == next);
+                REQUIRE(group.prevEdge(idx, slot, edge) == prev);
+            }
+        }
+    }
+}
+
+// The per-bit `switch` loop that `vpi_get_value` used before bit_convert.h, kept as the reference of the kernels.
+static void switchPackWords(const uint8_t *bits, size_t bitSize, uint32_t *words) {
+    uint32_t tmpVal = 0, tmpIdx = 0, wordIdx = 0;
+    for(int i = bitSize - 1; i >= 0; i--) {
+        switch(bits[i]) {
+        case 1:
+            tmpVal += 1 << tmpIdx;
+            break;
+        default: // `0`, `X`, `Z`
+            break;
+        }
+        if(++tmpIdx == 32) {
+            words[wordIdx++] = tmpVal;
+            tmpVal = 0;
+            tmpIdx = 0;
+        }
+    }
+    if(tmpIdx != 0) {
+        words[wordIdx] = tmpVal;
+    }
+}
+
+TEST_CASE("bitConvert", "[bitConvert]") {
+    std::vector<const BitConvertKernels *> allKernels{&bitConvertScalarKernels};
+#ifdef BIT_CONVERT_X86
+    allKernels.emplace_back(&bitConvertSse2Kernels);
+    if(__builtin_cpu_supports("avx2")) {
+        allKernels.emplace_back(&bitConvertAvx2Kernels);
+    }
+#endif
+
+    uint64_t seed = 1;
+    for(size_t bitSize = 1; bitSize <= 600; bitSize++) {
+        std::vector<uint8_t> bits(bitSize);
+        for(auto &bit : bits) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            bit = (seed >> 33) & 3; // `0`, `1`, `X` or `Z`
+        }
+
+        std::vector<uint32_t> expectWords((bitSize + 31) / 32);
+        switchPackWords(bits.data(), bitSize, expectWords.data());
+        std::vector<uint32_t> expectAvals(expectWords.size()), expectBvals(expectWords.size());
+        for(size_t i = 0; i < bitSize; i++) {
+            auto pos = bitSize - 1 - i;
+            expectAvals[pos / 32] |= (bits[i] == 1 || bits[i] == 2) << (pos % 32);
+            expectBvals[pos / 32] |= (bits[i] >= 2) << (pos % 32);
+        }
+        std::string expectBin, expectHex;
+        for(auto bit : bits) {
+            expectBin += "01xz"[bit];
+        }
+        for(size_t n = (bitSize + 3) / 4; n > 0; n--) {
+            expectHex += "0123456789abcdef"[(expectWords[(n - 1) / 8] >> ((n - 1) % 8 * 4)) & 0xf];
+        }
+
+        for(auto kernels : allKernels) {
+            std::vector<uint32_t> words(expectWords.size());
+            std::vector<char> str(bitSize + 1);
+            kernels->packWords(bits.data(), bitSize, words.data());
+            REQUIRE(words == expectWords);
+            std::vector<uint32_t> vecvals(expectWords.size() * 2), avals, bvals;
+            REQUIRE(kernels->packFourState(bits.data(), bitSize, vecvals.data()) == (std::find(bits.begin(), bits.end(), 2) != bits.end() || std::find(bits.begin(), bits.end(), 3) != bits.end()));
+            for(size_t i = 0; i < expectWords.size(); i++) {
+                avals.push_back(vecvals[2 * i]);
+                bvals.push_back(vecvals[2 * i + 1]);
+            }
+            REQUIRE(avals == expectAvals);
+            REQUIRE(bvals == expectBvals);
+            kernels->toBinStr(bits.data(), bitSize, str.data());
+            REQUIRE(std::string(str.data()) == expectBin);
+            kernels->wordsToHexStr(words.data(), bitSize, str.data());
+            REQUIRE(std::string(str.data()) == expectHex);
+        }
+    }
+
+    uint32_t vecvals[] = {0xF0F5A, 0xFF0F0};
+    char hexStr[8];
+    fourStateWordsToHexStr(vecvals, 20, hexStr);
+    REQUIRE(std::string(hexStr) == "xzfXa");
+}
+
+TEST_CASE("bitConvert benchmark", "[!benchmark][bitConvert]") {
+    for(size_t bitSize : {32, 512, 4096}) {
+        std::vector<uint8_t> bits(bitSize);
+        for(size_t i = 0; i < bits.size(); i++) {
+            bits[i] = (i * 7 + i / 3) & 3;
+        }
+        std::vector<uint32_t> words(bitSize / 32);
+        std::vector<uint32_t> vecvals(bitSize / 32 * 2);
+        auto suffix = fmt::format(" {} bits", bitSize);
+
+        BENCHMARK("switch" + suffix) {
+            switchPackWords(bits.data(), bits.size(), words.data());
+            return words[0];
+        };
+        BENCHMARK("scalar" + suffix) {
+            bitConvertScalarKernels.packWords(bits.data(), bits.size(), words.data());
+            return words[0];
+        };
+        BENCHMARK(std::string(bitConvert().name) + suffix) {
+            bitConvert().packWords(bits.data(), bits.size(), words.data());
+            return words[0];
+        };
+        BENCHMARK(std::string(bitConvert().name) + " vpiVectorVal" + suffix) {
+            bitConvert().packFourState(bits.data(), bits.size(), vecvals.data());
+            return vecvals[0];
+        };
+    }
+}
+
 int main(int argc, const char *argv[]) {
     auto vcdFile = std::string(std::getenv("PRJ_DIR")) + "/wellen/wellen/inputs/vcs/Apb_slave_uvm_new.vcd";
     fmt::println("vcdFile => {}", vcdFile);